@@ -6,10 +6,24 @@
  * @brief System to manage the students of the university
  */
 
+#define _POSIX_C_SOURCE 200809L // for clock_gettime
+
 #include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAS_X86_SIMD 1
+#endif
 
 #define SUCCESSFUL 0
 #define UNSUCCESSFUL 1
@@ -17,10 +31,42 @@
 #define LEN_OF_BEST 4
 #define LEN_OF_MERGE 5
 #define LEN_OF_QUICK 5
+#define LEN_OF_QUERY 5
+#define LEN_OF_GROUP 5
+#define LEN_OF_BENCH 5
+#define LEN_OF_GENERATE 8
 #define NUM_OF_EXPECTED_ARGS 2
 #define NUM_OF_EXPECTED_FIELDS 6
-#define MAX_NUM_STUDENTS 5500
-#define HALF_SIZE_OF_ARR 2750
+#define INITIAL_CAPACITY 64
+#define GROWTH_FACTOR 2
+#define MIN_BYTES_PER_ROW 22
+#define INITIAL_POOL_CAPACITY 4096
+#define INITIAL_INTERN_CAPACITY 256
+#define EMPTY_SLOT 0
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+#define NUM_OF_GRADES (HIGHEST_GRADE - LOWEST_GRADE + 1)
+#define INSERTION_SORT_CUTOFF 16
+#define NINTHER_THRESHOLD 128
+#define DEPTH_LIMIT_FACTOR 2
+#define NAME_PREFIX_LEN 8
+#define BITS_IN_BYTE 8
+#define LAST_BYTE_MASK 0xFF
+#define BITS_IN_WORD 64
+#define MAX_CLASSIFIED_LEN 320 // covers six maximal fields and their commas, a multiple of 64
+#define NUM_OF_MASK_WORDS (MAX_CLASSIFIED_LEN / BITS_IN_WORD)
+#define SSE_WIDTH 16
+#define AVX_WIDTH 32
+#define ID_FIELD 0
+#define NAME_FIELD 1
+#define GRADE_FIELD 2
+#define AGE_FIELD 3
+#define COUNTRY_FIELD 4
+#define CITY_FIELD 5
+#define NUMBER_CAP 1000 // bigger than any valid grade or age
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+#define MAX_OUTPUT_ROW_LEN 256 // longer than any printed student
+#define MAX_DIGITS 20
 #define MAX_ROW_LEN 61
 #define MAX_ERR_STR_LEN 100
 #define INVALID 0
@@ -36,10 +82,108 @@
 #define SECOND 2
 #define NO_STUDENTS 0
 #define TRUE 1
+#define NOT_FOUND -1
 #define BEST_STR "best"
 #define MERGE_STR "merge"
 #define QUICK_STR "quick"
-#define USAGE_MSG "USAGE: please type 'best', 'merge', or 'quick'\n"
+#define QUERY_STR "query"
+#define GROUP_STR "group"
+#define BENCH_STR "bench"
+#define GENERATE_STR "generate"
+#define INPUT_OPTION "--input"
+#define THREADS_OPTION "--threads"
+#define TOP_OPTION "--top"
+#define SAVE_SNAPSHOT_OPTION "--save-snapshot"
+#define LOAD_SNAPSHOT_OPTION "--load-snapshot"
+#define WRITE_BINARY "wb"
+#define SNAPSHOT_TEMP_SUFFIX ".tmp"
+#define SNAPSHOT_MAGIC 0x50414e5354534d31ull // "1MSTSNAP" - also tells apart files of the other byte order
+#define SNAPSHOT_VERSION 2
+#define FIRST_SNAPSHOT_VERSION 1
+#define SNAPSHOT_HAS_ORDERS 1
+#define APPEND_OPTION "--append"
+#define DELETE_OPTION "--delete"
+#define KEYS_OPTION "--keys"
+#define FILTER_OPTION "--filter"
+#define MAX_QUERY_TERMS 8
+#define KEYS_DELIMITER ','
+#define DESCENDING_MARK '-'
+#define NUM_OF_FIELDS 6
+#define LESS 1 // compare results, as bits of the results a filter accepts
+#define EQUAL 2
+#define GREATER 4
+#define BY_OPTION "--by"
+#define INITIAL_GROUPS_CAPACITY 64
+#define GROUP_HASH_MULTIPLIER 0x9e3779b1u
+#define GROUP_HASH_SHIFT 16
+#define DUPLICATES_OPTION "--duplicates"
+#define KEEP_DUPLICATES 0
+#define REPORT_DUPLICATES 1
+#define REPLACE_DUPLICATES 2
+#define KEEP_STR "keep"
+#define REPORT_STR "report"
+#define REPLACE_STR "replace"
+#define ID_HASH_MULTIPLIER 0x9e3779b97f4a7c15ull
+#define ID_HASH_SHIFT 32
+#define ROWS_OPTION "--rows"
+#define DISTRIBUTION_OPTION "--distribution"
+#define SEED_OPTION "--seed"
+#define RUNS_OPTION "--runs"
+#define SORTED_DISTRIBUTION 0
+#define REVERSED_DISTRIBUTION 1
+#define RANDOM_DISTRIBUTION 2
+#define DUPLICATES_DISTRIBUTION 3
+#define NUM_OF_DISTRIBUTIONS 4
+#define DEFAULT_NUM_OF_ROWS 100000
+#define MAX_NUM_OF_ROWS 100000000
+#define DEFAULT_SEED 88172645463325252ull
+#define XORSHIFT_A 12
+#define XORSHIFT_B 25
+#define XORSHIFT_C 27
+#define XORSHIFT_MULTIPLIER 0x2545f4914f6cdd1dull
+#define GENERATED_NAME_LEN 6
+#define NUM_OF_LETTERS 26
+#define NUM_OF_DUPLICATE_VALUES 4
+#define MIN_ID 1000000000ull
+#define MAX_ID 9999999999ull
+#define DEFAULT_NUM_OF_RUNS 5
+#define MAX_RUNS 1000
+#define NUM_OF_STAGES 6
+#define INGESTION_STAGE 0
+#define VALIDATION_STAGE 1
+#define GRADE_SORT_STAGE 2
+#define NAME_SORT_STAGE 3
+#define BEST_STAGE 4
+#define PRINT_STAGE 5
+#define MEDIAN_PERCENTILE 50
+#define HIGH_PERCENTILE 90
+#define PERCENT 100
+#define MS_IN_SECOND 1000.0
+#define NS_IN_MS 1000000
+#define NULL_DEVICE "/dev/null"
+#define MAX_ROWS_IN_MEMORY_OPTION "--max-rows-in-memory"
+#define RUN_BUFFER_SIZE (1 << 18)
+#define RECORD_HEADER_LEN 3 // the grade, and the length of the row in 2 bytes
+#define MERGE_FAN_IN 64 // the number of runs merged together, which bounds the number of open temporary files
+#define SNAPSHOT_ALIGNMENT 8
+#define CHECKSUM_PRIME 0x100000001b3ull
+#define CHECKSUM_BASIS 0xcbf29ce484222325ull
+#define MAX_TOP (1 << 24)
+#define FIRST_OPTION_ARG 2
+#define MAX_NUM_OF_THREADS 256
+#define MIN_PARALLEL_SORT_SIZE (1 << 14)
+#define READ_BINARY "rb"
+#define BATCH_BLOCK_SIZE (1 << 20)
+#define MIN_PARALLEL_READ_SIZE (1 << 20)
+#define CHUNKS_PER_THREAD 4 // more chunks than threads, so that a slow chunk doesn't hold the others back
+#define END_OF_LINE '\n'
+#define FIELDS_DELIMITER ','
+#define USAGE_MSG "USAGE: please type 'best', 'merge', 'quick', 'query', 'group', 'generate' or 'bench' " \
+                  "[--input <file>] [--threads <n>] [--top <k>] [--save-snapshot <file>] " \
+                  "[--load-snapshot <file> [--append <file>] [--delete <file>]] [--keys <field>[,-<field>...]] " \
+                  "[--filter <field><op><value>...] [--by country|city] [--duplicates keep|report|replace] " \
+                  "[--rows <n>] [--distribution sorted|reversed|random|duplicates] [--seed <n>] [--runs <n>] " \
+                  "[--max-rows-in-memory <n>]\n"
 #define GEN_MSG "Enter student info. To exit press q, then enter\n"
 #define ERROR_NUM_OF_ARGS_MSG "ERROR: wrong number of fields\n"
 #define ERROR_ID_MSG "ERROR: ID must contain 10 digits, first may not be zero\n"
@@ -48,493 +192,4373 @@
 #define ERROR_AGE_MSG "ERROR: age can only contain integer numbers in range 18-120\n"
 #define ERROR_COUNTRY_MSG "ERROR: country can only contain alphabetic characters or '-'\n"
 #define ERROR_CITY_MSG "ERROR: city can only contain alphabetic characters or '-'\n"
+#define ERROR_DUPLICATE_ID_MSG "ERROR: ID already belongs to another student\n"
 #define QUIT "q"
-#define BEST_INFO "best student info is: %s,%s,%ld,%ld,%s,%s"
+#define BEST_INFO "best student info is: %" PRIu64 ",%s,%d,%d,%s,%s\n"
+#define BENCH_HEADER "%d rows, %d runs, %d threads\nstage,p50 ms,p90 ms,max ms,rows/s\n"
+#define BENCH_INFO "%s,%.3f,%.3f,%.3f,%.0f\n"
+#define GROUP_INFO "%s,%d,%.2f,%d,%d,%.4f,%" PRIu64 "\n" // place, count, mean, min, max, best ratio, best id
 #define IN_LINE_N_MSG "in line %d\n"
 #define ERROR_READ_INFO "ERROR: could not read info\n"
-#define FORMAT_OF_FIELDS_PRINT "%s,%s,%ld,%ld,%s,%s"
-#define SSCANF_FORMAT "%43[^,],%43[^,],%43[^,],%43[^,],%43[^,],%43[^,]"
+#define ERROR_OPEN_INPUT "ERROR: could not open input file\n"
+#define ERROR_OPEN_OUTPUT "ERROR: could not open output file\n"
+#define ERROR_WRITE_OUTPUT "ERROR: could not write output\n"
+#define ERROR_ALLOCATION "ERROR: could not allocate memory\n"
+#define ERROR_TEMP_FILE "ERROR: could not write temporary file\n"
+#define ERROR_LOAD_SNAPSHOT "ERROR: could not load snapshot, the file is missing, corrupted or of another version\n"
+#define ERROR_SAVE_SNAPSHOT "ERROR: could not save snapshot\n"
+#define FORMAT_OF_FIELDS_PRINT "%" PRIu64 ",%s,%d,%d,%s,%s\n"
+
+/**
+ * This struct represents an arena of null terminated strings, which are referred to by their offset
+ */
+typedef struct StringPool
+{
+    char* data;
+    uint32_t size;
+    uint32_t capacity;
+} StringPool;
+
+/**
+ * This struct represents an open addressing hash set of strings in a pool, used for storing every distinct
+ * country and city only once. A slot holds the offset of the string plus one, 0 marks an empty slot
+ */
+typedef struct InternTable
+{
+    uint32_t* slots;
+    uint32_t capacity; // always a power of two
+    uint32_t numOfEntries;
+} InternTable;
+
+/**
+ * This struct represents a student while sorting - the key the students are sorted by, and the index of the
+ * student in the store. Only these pairs are moved while sorting, the students are gathered when printing
+ */
+typedef struct SortEntry
+{
+    uint32_t key;
+    int index;
+} SortEntry;
+
+/**
+ * This struct represents a slot of the index of ids. Valid ids never start with zero, so a zero id marks an empty
+ * slot
+ */
+typedef struct IdSlot
+{
+    uint64_t id;
+    int student; // the index of the student in the store
+} IdSlot;
+
+/**
+ * This struct represents an open addressing hash table from the ids of the students to their indices, which is
+ * used to find duplicate ids while reading. The ids are kept in the slots, so probing doesn't touch the store
+ */
+typedef struct IdIndex
+{
+    IdSlot* slots; // NULL if duplicate ids are kept
+    uint32_t capacity; // a power of 2
+    uint32_t numOfIds;
+    int lowestReplaced; // the lowest index of a student which was replaced by a later row, INT32_MAX if none was
+} IdIndex;
+
+/**
+ * This struct represents the students, kept column by column on the heap. A student is an index into the
+ * columns - it has id, name, grade, age, country and city. The strings are offsets into the pool, and countries
+ * and cities are interned, so equal places share the same offset
+ */
+typedef struct StudentStore
+{
+    uint64_t* ids;
+    unsigned char* grades;
+    unsigned char* ages;
+    uint32_t* nameOffsets;
+    uint64_t* namePrefixes; // the first 8 characters of each name, big endian and padded with zeros
+    uint32_t* countryOffsets;
+    uint32_t* cityOffsets;
+    int numOfStudents;
+    int capacity;
+    StringPool pool;
+    InternTable places;
+    SortEntry* gradeOrder; // the students sorted by grade, NULL until it is needed
+    SortEntry* nameOrder; // the students sorted by name, NULL until it is needed
+    void* mapping; // the mapped snapshot the columns point into, NULL if they are allocated on the heap
+    size_t mappingSize;
+    int areOrdersMapped; // 1 if the orders are in the mapped snapshot too, 0 if they are on the heap
+    int duplicateMode; // what to do with a student whose id is already in the store - KEEP_DUPLICATES,
+                       // REPORT_DUPLICATES or REPLACE_DUPLICATES
+    IdIndex idIndex;
+} StudentStore;
+
+/**
+ * This struct represents the header of a snapshot file. The header is followed by the columns of the store and
+ * the pool, in this order: ids, name prefixes, name offsets, country offsets, city offsets, grades, ages and
+ * pool. Since version 2 they may be followed by the orders of the students by grade and by name. Every section
+ * starts at a multiple of 8 bytes, and the checksum covers all of them including padding
+ */
+typedef struct SnapshotHeader
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numOfStudents;
+    uint32_t poolSize;
+    uint32_t flags;
+    uint64_t checksum;
+} SnapshotHeader;
+
+/**
+ * This struct represents a student while sorting by name - the prefix of the name, which decides most
+ * comparisons, the offset of the name in the pool for the rest, and the index of the student in the store
+ */
+typedef struct NameEntry
+{
+    uint64_t prefix;
+    uint32_t offset;
+    int index;
+} NameEntry;
+
+/**
+ * This struct represents a field in a row - its first character and its length
+ */
+typedef struct FieldSpan
+{
+    int start;
+    int len;
+} FieldSpan;
+
+/**
+ * This struct represents the classes of the characters of a row, one bit per character: digits, characters
+ * allowed in places (alphabetic characters and '-') and spaces
+ */
+typedef struct RowClasses
+{
+    uint64_t digits[NUM_OF_MASK_WORDS];
+    uint64_t places[NUM_OF_MASK_WORDS];
+    uint64_t spaces[NUM_OF_MASK_WORDS];
+} RowClasses;
+
+/**
+ * This struct represents a validated student row, whose strings point into the row
+ */
+typedef struct StudentRow
+{
+    uint64_t id;
+    int grade;
+    int age;
+    const char* name;
+    int nameLen;
+    const char* country;
+    int countryLen;
+    const char* city; // without the end of line
+    int cityLen;
+    int lineNum; // the line of the row in the input
+} StudentRow;
+
+/**
+ * This type represents a function which receives every valid student row while the input is read
+ */
+typedef void (*StudentFunc)(const StudentRow* student, void* context);
 
 /**
- * This struct represents a student, who has id, name, grade, age, country and city.
+ * This struct represents a student kept by the "best" command, with copies of its strings
  */
-typedef struct Student
+typedef struct RankedStudent
 {
-    char id[MAX_FIELD_LEN];
+    uint64_t id;
+    int grade;
+    int age;
+    long sequence; // the number of valid students before this one - earlier students win ties
     char name[MAX_FIELD_LEN];
-    long grade;
-    long age;
     char country[MAX_FIELD_LEN];
     char city[MAX_FIELD_LEN];
-} Student;
+} RankedStudent;
 
+/**
+ * This struct represents the best students seen so far, as a heap whose root is the worst of them
+ */
+typedef struct TopStudents
+{
+    RankedStudent* heap;
+    int size;
+    int capacity; // the number of best students to keep
+    long numOfSeen;
+} TopStudents;
 
 /**
- * This function checks if number of given student fields is valid
- * @param numOfGivenFields - the number of student fields given by the user
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if number of args is valid, 0 otherwise
+ * This struct represents the statistics of the students of a single country or city
  */
-int checkNumOfFieldsValidity(int numOfGivenFields, char outputValidityMsg[])
+typedef struct GroupStats
 {
-    if (numOfGivenFields != NUM_OF_EXPECTED_FIELDS)
-    {
-        strcpy(outputValidityMsg, ERROR_NUM_OF_ARGS_MSG);
-        return INVALID;
-    }
-    return VALID;
-}
+    uint32_t place; // the offset of the country or city in the pool
+    int count;
+    uint64_t gradesSum;
+    unsigned char minGrade;
+    unsigned char maxGrade;
+    unsigned char bestGrade; // grade and age of the student with the best ratio - the first one if there are ties
+    unsigned char bestAge;
+    uint64_t bestId;
+} GroupStats;
 
+/**
+ * This struct represents the groups of students by country or city. The groups are kept in the order they were
+ * first seen, and found by an open addressing hash table keyed on the interned offset of the place
+ */
+typedef struct GroupTable
+{
+    uint32_t* slots; // index of the group + 1, or EMPTY_SLOT
+    uint32_t capacity; // a power of 2
+    GroupStats* groups;
+    int numOfGroups;
+    int groupsCapacity;
+    int field; // COUNTRY_FIELD or CITY_FIELD
+    StudentStore* places; // interns the places of streamed students
+} GroupTable;
 
 /**
- * This function checks if the given ID is valid
- * @param idStr - the string of ID
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if ID is valid, 0 otherwise
+ * This type represents a function which classifies the first MAX_CLASSIFIED_LEN characters of a padded row
+ */
+typedef void (*ClassifyFunc)(const char row[], RowClasses* classes);
+
+/**
+ * This struct represents a buffer of output, which is written to the standard output when it fills up
  */
-int checkIDValidity(char idStr[], char outputValidityMsg[])
+typedef struct OutputBuffer
 {
-    int lenOfIdStr = (int)strlen(idStr);
-    if (lenOfIdStr != ID_LEN) // check if length of ID not 10
-    {
-        strcpy(outputValidityMsg, ERROR_ID_MSG);
-        return INVALID;
-    }
+    char* data;
+    int len;
+} OutputBuffer;
 
-    for (int i = 0; i < lenOfIdStr; i++)
-    {
-        if (!isdigit(idStr[i])) // check if one of the characters isn't a digit
-        {
-            strcpy(outputValidityMsg, ERROR_ID_MSG);
-            return INVALID;
-        }
-    }
+/**
+ * This struct represents a key of a query to sort the students by
+ */
+typedef struct SortKey
+{
+    int field; // one of the field indices, ID_FIELD to CITY_FIELD
+    int isDescending;
+} SortKey;
 
-    if (idStr[0] == '0') // check if first digit is zero
-    {
-        strcpy(outputValidityMsg, ERROR_ID_MSG);
-        return INVALID;
-    }
+/**
+ * This struct represents a condition of a query on a field of the students, such as age>=21. It is compiled once
+ * into the function which checks it and the compare results it accepts
+ */
+typedef struct Filter
+{
+    int field;
+    int acceptedResults; // LESS, EQUAL and GREATER bits, for the value of the student compared to the given value
+    uint64_t number; // the value of a numeric field
+    const char* str; // the value of a text field
+    uint32_t place; // the offset of the value in the pool of an interned field, NOT_FOUND if it isn't there
+    int (*compare)(const struct Filter* filter, const StudentStore* store, int i); // LESS, EQUAL or GREATER
+} Filter;
 
-    return VALID;
-}
+/**
+ * This struct represents a query - the students which pass all the filters, sorted by the keys in order
+ */
+typedef struct Query
+{
+    SortKey keys[MAX_QUERY_TERMS];
+    int numOfKeys;
+    Filter filters[MAX_QUERY_TERMS];
+    int numOfFilters;
+} Query;
 
+/**
+ * This struct represents the options given to the program after the command
+ */
+typedef struct Options
+{
+    const char* inputPath; // NULL means reading the students interactively
+    int numOfThreads;
+    int top; // the number of best students to print, 0 for only the best one
+    const char* saveSnapshotPath; // NULL means not saving a snapshot
+    const char* loadSnapshotPath; // NULL means reading the input instead of a snapshot
+    const char* appendPath; // students to add to the loaded snapshot, NULL if there are none
+    const char* deletePath; // ids of students to remove from the loaded snapshot, NULL if there are none
+    Query query; // the keys and filters of the query command
+    int groupField; // the field the group command groups by, COUNTRY_FIELD or CITY_FIELD
+    int duplicateMode; // what to do with students whose id was already read
+    long numOfRows; // the number of rows the generate command prints
+    int distribution; // the distribution of names and grades of generated rows
+    uint64_t seed;
+    int numOfRuns; // the number of times the bench command runs every stage
+    int maxRowsInMemory; // the number of students the merge command keeps in memory, 0 if there is no limit
+} Options;
 
 /**
- * This function checks if the given name is valid
- * @param nameStr - the string of the name
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if name is valid, 0 otherwise
+ * This struct represents an invalid row found while reading a chunk of the input
  */
-int checkNameValidity(char nameStr[], char outputValidityMsg[])
+typedef struct RowError
 {
-    int nameLen = (int)strlen(nameStr);
-    for (int i = 0; i < nameLen; i++)
-    {
-        if (!((nameStr[i] >= 'a' && nameStr[i] <= 'z') || (nameStr[i] >= 'A' && nameStr[i] <= 'Z') ||
-            nameStr[i] == '-' || nameStr[i] == ' '))
-        {
-            strcpy(outputValidityMsg, ERROR_NAME_MSG);
-            return INVALID;
-        }
-    }
+    int lineNum; // the line of the row in the chunk
+    char msg[MAX_ERR_STR_LEN];
+} RowError;
 
-    return VALID;
-}
+/**
+ * This struct represents a chunk of the input which is parsed on its own, and its valid students and errors. The
+ * strings of the students point into the input
+ */
+typedef struct ReadChunk
+{
+    const char* start;
+    const char* end; // right after an end of line, or the end of the input
+    StudentRow* students;
+    int numOfStudents;
+    int studentsCapacity;
+    RowError* errors;
+    int numOfErrors;
+    int errorsCapacity;
+    int numOfLines; // the lines which were parsed, before a quit row if there is one
+    int reachedQuit;
+} ReadChunk;
 
+/**
+ * This struct represents the chunks parsed by a single thread - every step-th chunk starting from the first
+ */
+typedef struct ReadTask
+{
+    ReadChunk* chunks;
+    int first;
+    int numOfChunks;
+    int step;
+} ReadTask;
 
 /**
- * This function checks if given grade is valid
- * @param gradeStr - the string of the grade
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if grade is valid, 0 otherwise
+ * This struct represents a sort of more students than are kept in memory - the students of the current run, and
+ * the temporary files of the runs which were already sorted
  */
-int checkGradeValidity(char gradeStr[], char outputValidityMsg[])
+typedef struct ExternalSort
 {
-    int gradeLen = (int)strlen(gradeStr);
+    StudentStore store; // the students of the current run
+    SortEntry* order;
+    char* buffer; // records to write to the file of a run
+    int maxRowsInMemory;
+    FILE** runs;
+    int* runLevels; // the number of merges every run went through, never increasing from the first run to the last
+    int numOfRuns;
+    int runsCapacity;
+} ExternalSort;
 
-    for (int i = 0; i < gradeLen; i++)
-    {
-        if(!isdigit(gradeStr[i])) // check if one of the characters isn't a digit
-        {
-            strcpy(outputValidityMsg, ERROR_GRADE_MSG);
-            return INVALID;
-        }
-    }
+/**
+ * This struct represents the reading of a sorted run while the runs are merged. The run is read in big blocks, and
+ * the current record points into the block
+ */
+typedef struct RunReader
+{
+    FILE* file;
+    char* data;
+    int len;
+    int pos; // the start of the current record
+    int isExhausted;
+    unsigned char grade;
+    const char* row; // the printed row of the current record, NULL before the first record
+    int rowLen;
+} RunReader;
 
-    long gradeLong = strtol(gradeStr, NULL , BASE);
-    if (gradeLong < LOWEST_GRADE || gradeLong > HIGHEST_GRADE) // check if grade is in the valid range
-    {
-        strcpy(outputValidityMsg, ERROR_GRADE_MSG);
-        return INVALID;
-    }
+/**
+ * This struct represents the students of a consecutive range in a parallel counting sort by grade, which are
+ * counted and then scattered by their own thread
+ */
+typedef struct GradeCountTask
+{
+    const StudentStore* store;
+    SortEntry* entries;
+    int start;
+    int end;
+    int positions[NUM_OF_GRADES]; // the counts of the grades, and then the next position of each grade
+} GradeCountTask;
 
-    return VALID;
+
+/**
+ * This function prints an allocation error and exits the program
+ */
+void exitOnAllocationFailure(void)
+{
+    printf(ERROR_ALLOCATION);
+    exit(UNSUCCESSFUL);
 }
 
 
 /**
- * This function checks if given age is valid
- * @param ageStr - the string of the age
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if age is valid, 0 otherwise
+ * This function reallocates a column of the store of students
+ * @param column - the column to reallocate
+ * @param elementSize - the size of a single element in the column
+ * @param capacity - the new number of elements in the column
+ * @return the reallocated column
  */
-int checkAgeValidity(char ageStr[], char outputValidityMsg[])
+void* resizeColumn(void* column, size_t elementSize, int capacity)
 {
-    int ageLen = (int)strlen(ageStr);
-
-    for (int i = 0; i < ageLen; i++)
+    void* resized = realloc(column, elementSize * capacity);
+    if (resized == NULL)
     {
-        if(!isdigit(ageStr[i])) // check if one of the characters isn't a digit
-        {
-            strcpy(outputValidityMsg, ERROR_AGE_MSG);
-            return INVALID;
-        }
+        exitOnAllocationFailure();
     }
+    return resized;
+}
 
-    long ageLong = strtol(ageStr, NULL , BASE);
-    if (ageLong < YOUNGEST_AGE || ageLong > OLDEST_AGE) // check if age is in the valid range
-    {
-        strcpy(outputValidityMsg, ERROR_AGE_MSG);
-        return INVALID;
-    }
 
-    return VALID;
+/**
+ * This function sets the capacity of all the columns of the store of students
+ * @param store - the store of students
+ * @param capacity - the new number of students the store can hold
+ */
+void resizeStudentStore(StudentStore* store, int capacity)
+{
+    store->ids = (uint64_t*)resizeColumn(store->ids, sizeof(uint64_t), capacity);
+    store->grades = (unsigned char*)resizeColumn(store->grades, sizeof(unsigned char), capacity);
+    store->ages = (unsigned char*)resizeColumn(store->ages, sizeof(unsigned char), capacity);
+    store->nameOffsets = (uint32_t*)resizeColumn(store->nameOffsets, sizeof(uint32_t), capacity);
+    store->namePrefixes = (uint64_t*)resizeColumn(store->namePrefixes, sizeof(uint64_t), capacity);
+    store->countryOffsets = (uint32_t*)resizeColumn(store->countryOffsets, sizeof(uint32_t), capacity);
+    store->cityOffsets = (uint32_t*)resizeColumn(store->cityOffsets, sizeof(uint32_t), capacity);
+    store->capacity = capacity;
 }
 
 
 /**
- * This function checks if given country is valid
- * @param countryStr -the string of the country
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if the country is valid, 0 otherwise
+ * This function initializes an empty store of students
+ * @param store - the store to initialize
+ * @param capacityHint - the expected number of students (0 if unknown)
  */
-int checkCountryValidity(char countryStr[], char outputValidityMsg[])
+void initStudentStore(StudentStore* store, long capacityHint)
 {
-    int countryLen = (int)strlen(countryStr);
+    memset(store, 0, sizeof(StudentStore));
+    resizeStudentStore(store, capacityHint > INITIAL_CAPACITY ? (int)capacityHint : INITIAL_CAPACITY);
 
-    for (int i = 0; i < countryLen; i++)
+    store->pool.capacity = INITIAL_POOL_CAPACITY;
+    store->pool.data = (char*)malloc(store->pool.capacity);
+    store->places.capacity = INITIAL_INTERN_CAPACITY;
+    store->places.slots = (uint32_t*)calloc(store->places.capacity, sizeof(uint32_t));
+    if (store->pool.data == NULL || store->places.slots == NULL)
     {
-        if (!((countryStr[i] >= 'a' && countryStr[i] <= 'z') || (countryStr[i] >= 'A' && countryStr[i] <= 'Z') ||
-            countryStr[i] == '-'))
-        {
-            strcpy(outputValidityMsg, ERROR_COUNTRY_MSG);
-            return INVALID;
-        }
+        exitOnAllocationFailure();
     }
-
-    return VALID;
 }
 
 
 /**
- * This function checks if given city is valid
- * @param cityStr - the string of the city
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if city is valid, 0 otherwise
+ * This function frees the memory of a store of students
+ * @param store - the store to free
  */
-int checkCityValidity(char cityStr[], char outputValidityMsg[])
+void freeStudentStore(StudentStore* store)
 {
-    int cityLen = (int)strlen(cityStr);
-
-    for (int i = 0; i < cityLen - 1; i++)
+    free(store->idIndex.slots);
+    if (store->mapping != NULL) // the columns are in the mapped snapshot, the orders may have been sorted later
     {
-        if (!((cityStr[i] >= 'a' && cityStr[i] <= 'z') || (cityStr[i] >= 'A' && cityStr[i] <= 'Z') ||
-            cityStr[i] == '-'))
+        if (!store->areOrdersMapped)
         {
-            strcpy(outputValidityMsg, ERROR_CITY_MSG);
-            return INVALID;
+            free(store->gradeOrder);
+            free(store->nameOrder);
         }
+        munmap(store->mapping, store->mappingSize);
+        memset(store, 0, sizeof(StudentStore));
+        return;
     }
-
-    if(cityStr[0] == '\n') // no input given for city
-    {
-        strcpy(outputValidityMsg, ERROR_CITY_MSG);
-        return INVALID;
-    }
-    return VALID;
+    free(store->gradeOrder);
+    free(store->nameOrder);
+    free(store->ids);
+    free(store->grades);
+    free(store->ages);
+    free(store->nameOffsets);
+    free(store->namePrefixes);
+    free(store->countryOffsets);
+    free(store->cityOffsets);
+    free(store->pool.data);
+    free(store->places.slots);
+    memset(store, 0, sizeof(StudentStore));
 }
 
 
 /**
- * This function checks if the fields of a given student are valid
- * @param numOfGivenFields
- * @param idStr - the string of the ID
- * @param nameStr - the string of name
- * @param gradeStr - the string of grade
- * @param ageStr - the string of age
- * @param countryStr - the string of country
- * @param cityStr - the string of city
- * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
- * @return 1 if the input fields are valid, 0 otherwise
+ * This function copies a string to the end of the pool
+ * @param pool - the pool of strings
+ * @param str - the string to copy (not necessarily null terminated)
+ * @param len - the number of characters in the string
+ * @return the offset of the copied string in the pool
  */
-int checkValidity(int numOfGivenFields, char idStr[], char nameStr[], char gradeStr[],
-                  char ageStr[], char countryStr[], char cityStr[], char outputValidityMsg[])
+uint32_t addToPool(StringPool* pool, const char str[], int len)
 {
-    if (!checkNumOfFieldsValidity(numOfGivenFields, outputValidityMsg) ||
-        !checkIDValidity(idStr, outputValidityMsg) ||
-        !checkNameValidity(nameStr, outputValidityMsg) ||
-        !checkGradeValidity(gradeStr, outputValidityMsg) ||
-        !checkAgeValidity(ageStr, outputValidityMsg) ||
-        !checkCountryValidity(countryStr, outputValidityMsg) ||
-        !checkCityValidity(cityStr, outputValidityMsg))
+    if ((uint64_t)pool->size + len + 1 > UINT32_MAX) // offsets must fit in 32 bits
     {
-        return INVALID;
+        exitOnAllocationFailure();
+    }
+    while (pool->size + len + 1 > pool->capacity)
+    {
+        uint32_t newCapacity = pool->capacity <= UINT32_MAX / GROWTH_FACTOR ? pool->capacity * GROWTH_FACTOR :
+                               UINT32_MAX;
+        char* grownData = (char*)realloc(pool->data, newCapacity);
+        if (grownData == NULL)
+        {
+            exitOnAllocationFailure();
+        }
+        pool->data = grownData;
+        pool->capacity = newCapacity;
     }
 
-    return VALID; // if we've reached here - the input fields are valid
+    uint32_t offset = pool->size;
+    memcpy(pool->data + offset, str, len);
+    pool->data[offset + len] = '\0';
+    pool->size += len + 1;
+    return offset;
 }
 
 
 /**
- * This function puts the information of each student the user typed in an array of students
- * @param studentsArray - an array of students
- * @return the number of students whose information was given
+ * This function calculates the FNV-1a hash of a string
+ * @param str - the string (not necessarily null terminated)
+ * @param len - the number of characters in the string
+ * @return the hash of the string
  */
-int buildStudentsArray(Student studentsArray[])
+uint32_t hashString(const char str[], int len)
 {
-    char idStr[MAX_FIELD_LEN];
-    char nameStr[MAX_FIELD_LEN];
-    char gradeStr[MAX_FIELD_LEN];
-    char ageStr[MAX_FIELD_LEN];
-    char countryStr[MAX_FIELD_LEN];
-    char cityStr[MAX_FIELD_LEN];
-    int isValid = 0;
-    int i = 0;
-    int numOfInputLines = -1; // used for counting the input lines typed by the user
-    char line[MAX_ROW_LEN]; // we will read the user's input into "line"
-    char outputValidityMsg[MAX_ERR_STR_LEN]; // the message that should be printed in case of invalidity
-
-    while (TRUE) // the user did not press q yet
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (int i = 0; i < len; i++)
     {
-        printf(GEN_MSG);
-        numOfInputLines++; // the user typed another legal/illegal input
-        if (fgets(line, MAX_ROW_LEN, stdin) == NULL) // reads the input to "line". if couldn't read, exit the program
-        {
-            printf(ERROR_READ_INFO);
-            printf(IN_LINE_N_MSG, numOfInputLines);
-            exit(UNSUCCESSFUL);
-        }
-
-        if ((strlen(line) == (LEN_OF_QUIT + 1)) && (!strncmp(QUIT, line, LEN_OF_QUIT)))
-        {
-            break; // the user pressed q
-        }
+        hash = (hash ^ (unsigned char)str[i]) * FNV_PRIME;
+    }
+    return hash;
+}
 
-        int numOfGivenFields = sscanf(line, SSCANF_FORMAT, idStr, nameStr, gradeStr,
-                                     ageStr, countryStr, cityStr); // divides the line into fields of student
-        isValid = checkValidity(numOfGivenFields, idStr, nameStr, gradeStr, ageStr, countryStr,
-                               cityStr, outputValidityMsg);
 
-        if (!isValid)
-        {
-            printf("%s", outputValidityMsg);
-            printf(IN_LINE_N_MSG, numOfInputLines);
-        }
+/**
+ * This function doubles the number of slots in the intern table, and re-inserts all the strings
+ * @param places - the intern table
+ * @param pool - the pool the interned strings are in
+ */
+void growInternTable(InternTable* places, const StringPool* pool)
+{
+    uint32_t newCapacity = places->capacity * GROWTH_FACTOR;
+    uint32_t* newSlots = (uint32_t*)calloc(newCapacity, sizeof(uint32_t));
+    if (newSlots == NULL)
+    {
+        exitOnAllocationFailure();
+    }
 
-        else // the input was valid - put the  student in the array of students
+    for (uint32_t i = 0; i < places->capacity; i++)
+    {
+        if (places->slots[i] != EMPTY_SLOT)
         {
-            strcpy(studentsArray[i].id, idStr);
-            strcpy(studentsArray[i].name, nameStr);
-            studentsArray[i].grade = strtol(gradeStr, NULL, BASE);
-            studentsArray[i].age = strtol(ageStr, NULL, BASE);
-            strcpy(studentsArray[i].country, countryStr);
-            strcpy(studentsArray[i].city, cityStr);
-            i++;
+            const char* str = pool->data + places->slots[i] - 1;
+            uint32_t slot = hashString(str, (int)strlen(str)) & (newCapacity - 1);
+            while (newSlots[slot] != EMPTY_SLOT) // linear probing
+            {
+                slot = (slot + 1) & (newCapacity - 1);
+            }
+            newSlots[slot] = places->slots[i];
         }
     }
-    return i; // number of students
+    free(places->slots);
+    places->slots = newSlots;
+    places->capacity = newCapacity;
 }
+
+
 /**
- * This function checks which student has the highest grade/age value
- * @param studentsArray The array of students
- * @param numOfStudents The number of actual students inserted to the array
- * @return The index in the students array of the student with the highest grade/age value
+ * This function returns the offset of a string in the pool, and adds it to the pool only if it isn't there yet
+ * @param store - the store of students
+ * @param str - the string to intern (not necessarily null terminated)
+ * @param len - the number of characters in the string
+ * @return the offset of the interned string in the pool
  */
-int findBestStudent(Student studentsArray[], int numOfStudents)
+uint32_t internString(StudentStore* store, const char str[], int len)
 {
-    int bestStudentIndex = 0;
-    double bestValue = 0.0; // highest grade/age value
-    double currValue = 0.0;
+    InternTable* places = &store->places;
+    if ((places->numOfEntries + 1) * GROWTH_FACTOR > places->capacity) // keep the load factor under half
+    {
+        growInternTable(places, &store->pool);
+    }
 
-    for (int j = 0; j < numOfStudents; j++)
+    uint32_t slot = hashString(str, len) & (places->capacity - 1);
+    while (places->slots[slot] != EMPTY_SLOT) // linear probing
     {
-        currValue = ((double)studentsArray[j].grade) / studentsArray[j].age;
-        if (currValue > bestValue)
+        const char* candidate = store->pool.data + places->slots[slot] - 1;
+        if (!strncmp(candidate, str, len) && candidate[len] == '\0')
         {
-            bestStudentIndex = j;
-            bestValue = currValue;
+            return places->slots[slot] - 1; // already interned
         }
+        slot = (slot + 1) & (places->capacity - 1);
     }
 
-    return bestStudentIndex;
+    uint32_t offset = addToPool(&store->pool, str, len);
+    places->slots[slot] = offset + 1;
+    places->numOfEntries++;
+    return offset;
 }
 
+
 /**
- * This function merges between two parts of students array
- * @param studentsArray - array of students
- * @param left - left index
- * @param middle - middle index
- * @param right - right index
+ * This function adds a string which is already in the pool to the table of interned strings, unless an equal
+ * string is interned already
+ * @param store - the store of students
+ * @param offset - the offset of the string in the pool
  */
-void merge(Student studentsArray[], int left, int middle, int right)
+void internPooledString(StudentStore* store, uint32_t offset)
 {
-    int i, j, k;
-    int n1 = middle - left + 1;
-    int n2 =  right - middle;
-    Student L[HALF_SIZE_OF_ARR], R[HALF_SIZE_OF_ARR]; // temp arrays - left part- array L, right part - array R
-
-    // copy students to temp arrays - L and R
-    for (i = 0; i < n1; i++)
+    InternTable* places = &store->places;
+    if ((places->numOfEntries + 1) * GROWTH_FACTOR > places->capacity) // keep the load factor under half
     {
-        L[i] = studentsArray[left + i];
-    }
-    for (j = 0; j < n2; j++)
-    {
-        R[j] = studentsArray[middle + 1 + j];
+        growInternTable(places, &store->pool);
     }
 
-    // merge the temp arrays
-    i = 0; // initial index of array L
-    j = 0; // initial index of array R
-    k = left;
-    while (i < n1 && j < n2)
+    const char* str = store->pool.data + offset;
+    uint32_t slot = hashString(str, (int)strlen(str)) & (places->capacity - 1);
+    while (places->slots[slot] != EMPTY_SLOT) // linear probing
     {
-        if (L[i].grade <= R[j].grade)
-        {
-            studentsArray[k] = L[i];
-            i++;
-        }
-        else
+        if (!strcmp(store->pool.data + places->slots[slot] - 1, str))
         {
-            studentsArray[k] = R[j];
-            j++;
+            return;
         }
-        k++;
+        slot = (slot + 1) & (places->capacity - 1);
     }
+    places->slots[slot] = offset + 1;
+    places->numOfEntries++;
+}
+
 
-    // copy the remaining elements of L
-    while (i < n1)
+/**
+ * This function packs the first characters of a name into an integer, so that comparing the integers of two names
+ * is the same as comparing the beginnings of the names in alphabetic order. Shorter names are padded with zeros
+ * @param name - the name (not necessarily null terminated)
+ * @param nameLen - the number of characters in the name
+ * @return the prefix of the name, big endian
+ */
+uint64_t namePrefix(const char name[], int nameLen)
+{
+    uint64_t prefix = 0;
+    int i = 0;
+    for (; i < NAME_PREFIX_LEN && i < nameLen; i++)
     {
-        studentsArray[k] = L[i];
-        i++;
-        k++;
+        prefix = (prefix << BITS_IN_BYTE) | (unsigned char)name[i];
     }
-
-    // copy the remaining elements of R
-    while (j < n2)
+    for (; i < NAME_PREFIX_LEN; i++)
     {
-        studentsArray[k] = R[j];
-        j++;
-        k++;
+        prefix <<= BITS_IN_BYTE;
     }
+    return prefix;
 }
 
 
 /**
- * This function sorts the array of students according to their grades
- * @param studentsArray - array of students to be sorted by grade
- * @param left - left index of array
- * @param right - right index of array
+ * This function initializes an empty index of ids
+ * @param index - the index
+ * @param expectedNumOfIds - the number of ids the index is expected to hold, so that it rarely has to grow
  */
-void mergeSort(Student studentsArray[], int left, int right)
+void initIdIndex(IdIndex* index, long expectedNumOfIds)
 {
-    if (left < right)
+    index->capacity = INITIAL_CAPACITY * GROWTH_FACTOR;
+    while (index->capacity < expectedNumOfIds * GROWTH_FACTOR) // keep the load factor under half
+    {
+        index->capacity *= GROWTH_FACTOR;
+    }
+    index->slots = (IdSlot*)calloc(index->capacity, sizeof(IdSlot));
+    index->numOfIds = 0;
+    index->lowestReplaced = INT32_MAX;
+    if (index->slots == NULL)
     {
-        int middle = left + (right - left) / 2;
-        mergeSort(studentsArray, left, middle);
-        mergeSort(studentsArray, middle + 1, right);
-        merge(studentsArray, left, middle, right);
+        exitOnAllocationFailure();
     }
 }
 
 
 /**
- * This function compares between two names, and checks which one is "higher" according to alphabetic order
- * @param name1 - first name to compare
- * @param name2 - second name to compare
- * @return 1 if the first name is "higher", 2 if the second name is "higher"
+ * @param id - an id
+ * @param capacity - the capacity of the index, a power of 2
+ * @return the first slot to look for the id in
  */
-int compareNames(char name1[], char name2[])
+uint32_t idSlot(uint64_t id, uint32_t capacity)
 {
-    int name1Len = (int)strlen(name1);
-    for (int i = 0; i < name1Len; i++)
-    {
-        if(name1[i] > name2[i])
-        {
-            return FIRST;
-        }
-        if (name1[i] < name2[i])
-        {
-            return SECOND;
-        }
-    }
-
-    return SECOND;
+    uint64_t hash = id * ID_HASH_MULTIPLIER; // ids are spread by multiplying, then the high bits are mixed in
+    return (uint32_t)(hash ^ (hash >> ID_HASH_SHIFT)) & (capacity - 1);
 }
 
 
 /**
- * This function sorts the array of students according to alphabetic order of name
- * @param studentsArray - the array of students
- * @param left - left index of array
- * @param right - right index of array
+ * This function finds the student of an id, and adds the id with the given student if it isn't in the index yet
+ * @param index - the index
+ * @param id - the id
+ * @param student - the index of the student in the store, for a new id
+ * @return the index of the student which already has the id, or -1 if the id is new
  */
-void quickSort(Student studentsArray[], int left, int right)
+int findOrAddId(IdIndex* index, uint64_t id, int student)
 {
-    int i, j, pivot;
-    Student temp;
-    if (left < right) // there is still sorting to be done
+    if ((index->numOfIds + 1) * GROWTH_FACTOR > index->capacity) // keep the load factor under half
     {
-        pivot = left;
-        i = left;
-        j = right;
-
-        while(i < j)
+        IdSlot* oldSlots = index->slots;
+        uint32_t oldCapacity = index->capacity;
+        index->capacity *= GROWTH_FACTOR;
+        index->slots = (IdSlot*)calloc(index->capacity, sizeof(IdSlot));
+        if (index->slots == NULL)
         {
-            while((compareNames(studentsArray[i].name, studentsArray[pivot].name) == SECOND)  &&  i < right)
-            {
-                i++;
-            }
-
-            while(compareNames(studentsArray[j].name, studentsArray[pivot].name) == FIRST)
-            {
-                j--;
-            }
-
-            if(i < j)
+            exitOnAllocationFailure();
+        }
+        for (uint32_t i = 0; i < oldCapacity; i++)
+        {
+            uint32_t slot = idSlot(oldSlots[i].id, index->capacity);
+            while (oldSlots[i].id != EMPTY_SLOT && index->slots[slot].id != EMPTY_SLOT) // linear probing
             {
-                temp = studentsArray[i];
-                studentsArray[i] = studentsArray[j];
-                studentsArray[j] = temp;
+                slot = (slot + 1) & (index->capacity - 1);
             }
+            index->slots[slot] = oldSlots[i].id != EMPTY_SLOT ? oldSlots[i] : index->slots[slot];
         }
+        free(oldSlots);
+    }
 
-        temp = studentsArray[pivot];
-        studentsArray[pivot] = studentsArray[j];
-        studentsArray[j] = temp;
-        quickSort(studentsArray, left, j - 1);
-        quickSort(studentsArray, j + 1, right);
+    uint32_t slot = idSlot(id, index->capacity);
+    while (index->slots[slot].id != EMPTY_SLOT) // linear probing
+    {
+        if (index->slots[slot].id == id)
+        {
+            return index->slots[slot].student;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
     }
+    index->slots[slot].id = id;
+    index->slots[slot].student = student;
+    index->numOfIds++;
+    return NOT_FOUND;
 }
 
+
 /**
- * This function prints the array of students
- * @param numOfStudents - the number of students in the array
- * @param studentsArray - the array of students
+ * This function adds the ids of all the students of a store to its index. If the store already has duplicate ids,
+ * the first student of every id is indexed
+ * @param store - the store of students
  */
-void printStudents(int numOfStudents, Student studentsArray[])
+void indexStudentIds(StudentStore* store)
 {
-    for (int i = 0; i < numOfStudents; i++)
+    initIdIndex(&store->idIndex, store->numOfStudents);
+    for (int i = 0; i < store->numOfStudents; i++)
     {
-        printf(FORMAT_OF_FIELDS_PRINT, studentsArray[i].id,
-               studentsArray[i].name, studentsArray[i].grade,
-               studentsArray[i].age, studentsArray[i].country,
-               studentsArray[i].city);
+        findOrAddId(&store->idIndex, store->ids[i], i);
     }
 }
 
 
+/**
+ * This function replaces the fields of a student with the fields of a later row with the same id. The student keeps
+ * its place in the store
+ * @param store - the store of students
+ * @param i - the index of the student
+ * @param student - the later row
+ */
+void replaceStudent(StudentStore* store, int i, const StudentRow* student)
+{
+    store->grades[i] = (unsigned char)student->grade;
+    store->ages[i] = (unsigned char)student->age;
+    store->nameOffsets[i] = addToPool(&store->pool, student->name, student->nameLen);
+    store->namePrefixes[i] = namePrefix(student->name, student->nameLen);
+    store->countryOffsets[i] = internString(store, student->country, student->countryLen);
+    store->cityOffsets[i] = internString(store, student->city, student->cityLen);
+    if (i < store->idIndex.lowestReplaced)
+    {
+        store->idIndex.lowestReplaced = i;
+    }
+}
+
+
+/**
+ * This function adds a student to the end of the store, and grows the store geometrically if it is full
+ * @param store - the store of students
+ * @param student - the validated row of the student
+ */
+void appendStudent(StudentStore* store, const StudentRow* student)
+{
+    if (store->numOfStudents == store->capacity)
+    {
+        resizeStudentStore(store, store->capacity * GROWTH_FACTOR);
+    }
+    int i = store->numOfStudents;
+    store->ids[i] = student->id;
+    store->grades[i] = (unsigned char)student->grade;
+    store->ages[i] = (unsigned char)student->age;
+    store->nameOffsets[i] = addToPool(&store->pool, student->name, student->nameLen);
+    store->namePrefixes[i] = namePrefix(student->name, student->nameLen);
+    store->countryOffsets[i] = internString(store, student->country, student->countryLen);
+    store->cityOffsets[i] = internString(store, student->city, student->cityLen);
+    store->numOfStudents++;
+}
+
+
+/**
+ * @param store - the store of students
+ * @param i - the index of the student
+ * @return the name of the student
+ */
+const char* getName(const StudentStore* store, int i)
+{
+    return store->pool.data + store->nameOffsets[i];
+}
+
+
+/**
+ * This function classifies the characters of a row one at a time. It is used when no vector instructions are
+ * available
+ * @param row - the row, padded with zeros to MAX_CLASSIFIED_LEN characters
+ * @param classes - the output classes of the characters
+ */
+void classifyRowScalar(const char row[], RowClasses* classes)
+{
+    memset(classes, 0, sizeof(RowClasses));
+    for (int i = 0; i < MAX_CLASSIFIED_LEN; i++)
+    {
+        char c = row[i];
+        uint64_t bit = (uint64_t)1 << (i % BITS_IN_WORD);
+        if (c >= '0' && c <= '9')
+        {
+            classes->digits[i / BITS_IN_WORD] |= bit;
+        }
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-')
+        {
+            classes->places[i / BITS_IN_WORD] |= bit;
+        }
+        if (c == ' ')
+        {
+            classes->spaces[i / BITS_IN_WORD] |= bit;
+        }
+    }
+}
+
+#ifdef HAS_X86_SIMD
+/**
+ * This function classifies the characters of a row 16 at a time, using SSE2
+ * @param row - the row, padded with zeros to MAX_CLASSIFIED_LEN characters
+ * @param classes - the output classes of the characters
+ */
+__attribute__((target("sse2")))
+void classifyRowSse2(const char row[], RowClasses* classes)
+{
+    memset(classes, 0, sizeof(RowClasses));
+    for (int i = 0; i < MAX_CLASSIFIED_LEN; i += SSE_WIDTH)
+    {
+        __m128i chars = _mm_loadu_si128((const __m128i*)(row + i));
+        __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20)); // lower case of alphabetic characters
+        __m128i digits = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                       _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+        __m128i places = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                                    _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1))),
+                                      _mm_cmpeq_epi8(chars, _mm_set1_epi8('-')));
+        __m128i spaces = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+
+        int shift = i % BITS_IN_WORD;
+        classes->digits[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm_movemask_epi8(digits) << shift;
+        classes->places[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm_movemask_epi8(places) << shift;
+        classes->spaces[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm_movemask_epi8(spaces) << shift;
+    }
+}
+
+/**
+ * This function classifies the characters of a row 32 at a time, using AVX2
+ * @param row - the row, padded with zeros to MAX_CLASSIFIED_LEN characters
+ * @param classes - the output classes of the characters
+ */
+__attribute__((target("avx2")))
+void classifyRowAvx2(const char row[], RowClasses* classes)
+{
+    memset(classes, 0, sizeof(RowClasses));
+    for (int i = 0; i < MAX_CLASSIFIED_LEN; i += AVX_WIDTH)
+    {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)(row + i));
+        __m256i lower = _mm256_or_si256(chars, _mm256_set1_epi8(0x20)); // lower case of alphabetic characters
+        __m256i digits = _mm256_andnot_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('9')),
+                                             _mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)));
+        __m256i letters = _mm256_andnot_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('z')),
+                                              _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)));
+        __m256i places = _mm256_or_si256(letters, _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-')));
+        __m256i spaces = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' '));
+
+        int shift = i % BITS_IN_WORD;
+        classes->digits[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm256_movemask_epi8(digits) << shift;
+        classes->places[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm256_movemask_epi8(places) << shift;
+        classes->spaces[i / BITS_IN_WORD] |= (uint64_t)(unsigned)_mm256_movemask_epi8(spaces) << shift;
+    }
+}
+#endif
+
+
+/**
+ * This function chooses the fastest way to classify rows which this processor supports
+ * @return the classify function
+ */
+ClassifyFunc chooseClassifyFunc(void)
+{
+#ifdef HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return classifyRowAvx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        return classifyRowSse2;
+    }
+#endif
+    return classifyRowScalar;
+}
+
+
+/**
+ * This function returns the classifier of the rows, which is chosen the first time it is needed
+ * @return the classifier
+ */
+ClassifyFunc getClassifyFunc(void)
+{
+    static ClassifyFunc classify = NULL;
+    if (classify == NULL)
+    {
+        classify = chooseClassifyFunc();
+    }
+    return classify;
+}
+
+
+/**
+ * This function checks if all the characters of a range belong to a class
+ * @param mask - the mask of the class, one bit per character
+ * @param start - the first character of the range
+ * @param len - the number of characters in the range
+ * @return 1 if all the characters belong to the class, 0 otherwise
+ */
+int isRangeInMask(const uint64_t mask[], int start, int len)
+{
+    for (int i = start; i < start + len;)
+    {
+        int bit = i % BITS_IN_WORD;
+        int numOfBits = BITS_IN_WORD - bit < start + len - i ? BITS_IN_WORD - bit : start + len - i;
+        uint64_t wanted = (numOfBits == BITS_IN_WORD ? ~(uint64_t)0 : (((uint64_t)1 << numOfBits) - 1)) << bit;
+        if ((mask[i / BITS_IN_WORD] & wanted) != wanted)
+        {
+            return INVALID;
+        }
+        i += numOfBits;
+    }
+    return VALID;
+}
+
+
+/**
+ * This function reads a number made only of digits. Numbers above NUMBER_CAP are read as NUMBER_CAP
+ * @param str - the digits (not necessarily null terminated)
+ * @param len - the number of digits
+ * @return the number
+ */
+long readNumber(const char str[], int len)
+{
+    long number = 0;
+    for (int i = 0; i < len && number < NUMBER_CAP; i++)
+    {
+        number = number * BASE + (str[i] - '0');
+    }
+    return number < NUMBER_CAP ? number : NUMBER_CAP;
+}
+
+
+/**
+ * This function divides a row into the fields of a student in a single pass. It accepts what "%42[^,],%42[^,],..."
+ * would accept: every field is a non-empty run of non-comma characters, at most MAX_FIELD_LEN - 1 of them so it fits
+ * a field buffer with its terminator, and the scan stops at the first field that is empty or too long
+ * @param row - the row to divide (not necessarily null terminated)
+ * @param rowLen - the number of characters in the row
+ * @param fields - the output fields (id, name, grade, age, country, city)
+ * @return the number of fields that were read
+ */
+int splitRowToFields(const char row[], int rowLen, FieldSpan fields[])
+{
+    int pos = 0;
+    for (int field = 0; field < NUM_OF_EXPECTED_FIELDS; field++)
+    {
+        if (field > 0)
+        {
+            if (pos >= rowLen || row[pos] != FIELDS_DELIMITER) // the previous field wasn't followed by a comma
+            {
+                return field;
+            }
+            pos++;
+        }
+
+        fields[field].start = pos;
+        while (pos < rowLen && row[pos] != FIELDS_DELIMITER && row[pos] != '\0' &&
+               pos - fields[field].start < MAX_FIELD_LEN - 1)
+        {
+            pos++;
+        }
+        fields[field].len = pos - fields[field].start;
+
+        if (fields[field].len == 0) // an empty field can't be read
+        {
+            return field;
+        }
+    }
+    return NUM_OF_EXPECTED_FIELDS;
+}
+
+
+/**
+ * This function checks if the fields of a row are valid. The characters of the row are classified once, and the
+ * verdict of every field is derived from the classes of its characters
+ * @param row - the row to validate (not necessarily null terminated)
+ * @param rowLen - the number of characters in the row
+ * @param student - the student of the row, filled if the row is valid
+ * @param outputValidityMsg - the message that should be printed in case of invalidity (given "empty")
+ * @return 1 if the row is valid, 0 otherwise
+ */
+int validateRow(const char row[], int rowLen, StudentRow* student, char outputValidityMsg[])
+{
+    ClassifyFunc classify = getClassifyFunc();
+
+    FieldSpan fields[NUM_OF_EXPECTED_FIELDS];
+    if (splitRowToFields(row, rowLen, fields) != NUM_OF_EXPECTED_FIELDS)
+    {
+        strcpy(outputValidityMsg, ERROR_NUM_OF_ARGS_MSG);
+        return INVALID;
+    }
+
+    // all the fields end before MAX_CLASSIFIED_LEN, pad the row so the classifier reads full vectors
+    char padded[MAX_CLASSIFIED_LEN] = {0};
+    int fieldsEnd = fields[CITY_FIELD].start + fields[CITY_FIELD].len;
+    memcpy(padded, row, fieldsEnd);
+    RowClasses classes;
+    classify(padded, &classes);
+
+    const FieldSpan* id = &fields[ID_FIELD];
+    if (id->len != ID_LEN || !isRangeInMask(classes.digits, id->start, id->len) || row[id->start] == '0')
+    {
+        strcpy(outputValidityMsg, ERROR_ID_MSG);
+        return INVALID;
+    }
+
+    const FieldSpan* name = &fields[NAME_FIELD];
+    for (int i = 0; i < NUM_OF_MASK_WORDS; i++) // names may also contain spaces
+    {
+        classes.spaces[i] |= classes.places[i];
+    }
+    if (!isRangeInMask(classes.spaces, name->start, name->len))
+    {
+        strcpy(outputValidityMsg, ERROR_NAME_MSG);
+        return INVALID;
+    }
+
+    const FieldSpan* grade = &fields[GRADE_FIELD];
+    student->grade = isRangeInMask(classes.digits, grade->start, grade->len) ?
+                     (int)readNumber(row + grade->start, grade->len) : NUMBER_CAP;
+    if (student->grade < LOWEST_GRADE || student->grade > HIGHEST_GRADE)
+    {
+        strcpy(outputValidityMsg, ERROR_GRADE_MSG);
+        return INVALID;
+    }
+
+    const FieldSpan* age = &fields[AGE_FIELD];
+    student->age = isRangeInMask(classes.digits, age->start, age->len) ?
+                   (int)readNumber(row + age->start, age->len) : NUMBER_CAP;
+    if (student->age < YOUNGEST_AGE || student->age > OLDEST_AGE)
+    {
+        strcpy(outputValidityMsg, ERROR_AGE_MSG);
+        return INVALID;
+    }
+
+    const FieldSpan* country = &fields[COUNTRY_FIELD];
+    if (!isRangeInMask(classes.places, country->start, country->len))
+    {
+        strcpy(outputValidityMsg, ERROR_COUNTRY_MSG);
+        return INVALID;
+    }
+
+    // the last character of the city is expected to be the end of line, and isn't checked
+    const FieldSpan* city = &fields[CITY_FIELD];
+    if (!isRangeInMask(classes.places, city->start, city->len - 1) || row[city->start] == END_OF_LINE)
+    {
+        strcpy(outputValidityMsg, ERROR_CITY_MSG);
+        return INVALID;
+    }
+
+    // the row is valid - fill the student
+    student->id = 0;
+    for (int i = 0; i < ID_LEN; i++)
+    {
+        student->id = student->id * BASE + (row[id->start + i] - '0');
+    }
+    student->name = row + name->start;
+    student->nameLen = name->len;
+    student->country = row + country->start;
+    student->countryLen = country->len;
+    student->city = row + city->start;
+    student->cityLen = row[fieldsEnd - 1] == END_OF_LINE ? city->len - 1 : city->len;
+    return VALID;
+}
+
+
+/**
+ * This function finds the length of the next row, the same way the interactive mode splits its input with
+ * fgets - up to and including the end of line, but never more than MAX_ROW_LEN - 1 characters, so a longer line
+ * is read as several rows
+ * @param row - the start of the row
+ * @param numOfAvailable - the number of characters left in the input
+ * @return the number of characters in the row
+ */
+int getRowLen(const char row[], long numOfAvailable)
+{
+    int maxRowLen = numOfAvailable < MAX_ROW_LEN - 1 ? (int)numOfAvailable : MAX_ROW_LEN - 1;
+    const char* rowEnd = memchr(row, END_OF_LINE, maxRowLen);
+    return rowEnd == NULL ? maxRowLen : (int)(rowEnd - row) + 1;
+}
+
+
+/**
+ * This function checks if a row is the quit row ("q" followed by enter)
+ * @param row - the row to check
+ * @param rowLen - the number of characters in the row
+ * @return 1 if the row is the quit row, 0 otherwise
+ */
+int isQuitRow(const char row[], int rowLen)
+{
+    return (rowLen == (LEN_OF_QUIT + 1)) && (!strncmp(QUIT, row, LEN_OF_QUIT));
+}
+
+
+/**
+ * This function validates a single row, and passes the student on if the row is valid. Otherwise an
+ * informative message is printed
+ * @param row - the row to process
+ * @param rowLen - the number of characters in the row
+ * @param lineNum - the number of the row in the input (used for error messages)
+ * @param onStudent - the function which receives the valid student
+ * @param context - passed to onStudent
+ */
+void processRow(const char row[], int rowLen, int lineNum, StudentFunc onStudent, void* context)
+{
+    StudentRow student;
+    char outputValidityMsg[MAX_ERR_STR_LEN]; // the message that should be printed in case of invalidity
+
+    if (!validateRow(row, rowLen, &student, outputValidityMsg))
+    {
+        printf("%s", outputValidityMsg);
+        printf(IN_LINE_N_MSG, lineNum);
+        return;
+    }
+
+    student.lineNum = lineNum;
+    onStudent(&student, context); // the input was valid - pass the student on
+}
+
+
+/**
+ * This function reads the information of each student the user typed
+ * @param onStudent - the function which receives every valid student
+ * @param context - passed to onStudent
+ */
+void readRowsInteractively(StudentFunc onStudent, void* context)
+{
+    int numOfInputLines = -1; // used for counting the input lines typed by the user
+    char line[MAX_ROW_LEN]; // we will read the user's input into "line"
+
+    while (TRUE) // the user did not press q yet
+    {
+        printf(GEN_MSG);
+        numOfInputLines++; // the user typed another legal/illegal input
+        if (fgets(line, MAX_ROW_LEN, stdin) == NULL) // reads the input to "line". if couldn't read, exit the program
+        {
+            printf(ERROR_READ_INFO);
+            printf(IN_LINE_N_MSG, numOfInputLines);
+            exit(UNSUCCESSFUL);
+        }
+
+        int lineLen = (int)strlen(line);
+        if (isQuitRow(line, lineLen))
+        {
+            break; // the user pressed q
+        }
+
+        processRow(line, lineLen, numOfInputLines, onStudent, context);
+    }
+}
+
+
+/**
+ * This function opens an input file, and exits the program if it can't be opened
+ * @param inputPath - the path of the input file
+ * @return the opened file
+ */
+FILE* openInputFile(const char inputPath[])
+{
+    FILE* inputFile = fopen(inputPath, READ_BINARY);
+    if (inputFile == NULL)
+    {
+        printf(ERROR_OPEN_INPUT);
+        exit(UNSUCCESSFUL);
+    }
+    return inputFile;
+}
+
+
+/**
+ * This function reads the students from a file in big blocks, without prompting. Reading stops at the end of
+ * the file or at a quit row. Lines are split into rows and numbered the same way as in the interactive mode
+ * @param inputPath - the path of the input file
+ * @param onStudent - the function which receives every valid student
+ * @param context - passed to onStudent
+ */
+void readRowsFromFile(const char inputPath[], StudentFunc onStudent, void* context)
+{
+    FILE* inputFile = openInputFile(inputPath);
+    long capacity = BATCH_BLOCK_SIZE;
+    char* buffer = (char*)malloc(capacity);
+    if (buffer == NULL)
+    {
+        fclose(inputFile);
+        exitOnAllocationFailure();
+    }
+
+    int lineNum = 0;
+    long numOfPending = 0; // characters of a row whose end wasn't read yet, kept at the start of the buffer
+    int reachedQuit = 0;
+
+    while (!reachedQuit)
+    {
+        long numOfRead = (long)fread(buffer + numOfPending, 1, capacity - numOfPending, inputFile);
+        long bufferLen = numOfPending + numOfRead;
+        int isLastBlock = (numOfRead == 0);
+        long rowStart = 0;
+
+        while (rowStart < bufferLen)
+        {
+            int rowLen = getRowLen(buffer + rowStart, bufferLen - rowStart);
+            if (rowLen == bufferLen - rowStart && buffer[rowStart + rowLen - 1] != END_OF_LINE &&
+                rowLen < MAX_ROW_LEN - 1 && !isLastBlock) // the rest of the row is in the next block
+            {
+                break;
+            }
+
+            if (isQuitRow(buffer + rowStart, rowLen))
+            {
+                reachedQuit = 1;
+                break;
+            }
+            processRow(buffer + rowStart, rowLen, lineNum, onStudent, context);
+            lineNum++;
+            rowStart += rowLen;
+        }
+
+        if (isLastBlock)
+        {
+            break;
+        }
+        numOfPending = bufferLen - rowStart;
+        memmove(buffer, buffer + rowStart, numOfPending);
+    }
+
+    free(buffer);
+    fclose(inputFile); // only read from the file, no need to check if fclose worked
+}
+
+
+/**
+ * This function puts a student in the store of students. Unless duplicate ids are kept, a student whose id is
+ * already in the store is either reported as an invalid row or replaces the student which has the id
+ * @param student - the validated row of the student
+ * @param context - the store of students
+ */
+void storeStudent(const StudentRow* student, void* context)
+{
+    StudentStore* store = (StudentStore*)context;
+    if (store->duplicateMode != KEEP_DUPLICATES)
+    {
+        int existing = findOrAddId(&store->idIndex, student->id, store->numOfStudents);
+        if (existing != NOT_FOUND && store->duplicateMode == REPORT_DUPLICATES)
+        {
+            printf(ERROR_DUPLICATE_ID_MSG);
+            printf(IN_LINE_N_MSG, student->lineNum);
+            return;
+        }
+        if (existing != NOT_FOUND)
+        {
+            replaceStudent(store, existing, student);
+            return;
+        }
+    }
+    appendStudent(store, student);
+}
+
+
+/**
+ * This function finds the students and the errors of a chunk of the input, the same way the rows are processed
+ * when reading them one by one. The chunk stops at a quit row
+ * @param chunk - the chunk
+ */
+void parseChunk(ReadChunk* chunk)
+{
+    const char* row = chunk->start;
+    while (row < chunk->end)
+    {
+        int rowLen = getRowLen(row, chunk->end - row);
+        if (isQuitRow(row, rowLen))
+        {
+            chunk->reachedQuit = TRUE;
+            return;
+        }
+
+        if (chunk->numOfStudents == chunk->studentsCapacity)
+        {
+            chunk->studentsCapacity *= GROWTH_FACTOR;
+            chunk->students = (StudentRow*)resizeColumn(chunk->students, sizeof(StudentRow), chunk->studentsCapacity);
+        }
+        if (chunk->numOfErrors == chunk->errorsCapacity)
+        {
+            chunk->errorsCapacity *= GROWTH_FACTOR;
+            chunk->errors = (RowError*)resizeColumn(chunk->errors, sizeof(RowError), chunk->errorsCapacity);
+        }
+
+        RowError* error = &chunk->errors[chunk->numOfErrors];
+        if (validateRow(row, rowLen, &chunk->students[chunk->numOfStudents], error->msg))
+        {
+            chunk->students[chunk->numOfStudents++].lineNum = chunk->numOfLines;
+        }
+        else
+        {
+            error->lineNum = chunk->numOfLines;
+            chunk->numOfErrors++;
+        }
+        chunk->numOfLines++;
+        row += rowLen;
+    }
+}
+
+
+/**
+ * This function parses the chunks of a single thread
+ * @param arg - the read task
+ * @return NULL
+ */
+void* runReadTask(void* arg)
+{
+    ReadTask* task = (ReadTask*)arg;
+    for (int c = task->first; c < task->numOfChunks; c += task->step)
+    {
+        parseChunk(&task->chunks[c]);
+    }
+    return NULL;
+}
+
+
+/**
+ * This function reads the students of an input file on several threads. The file is split at ends of lines into
+ * chunks which are parsed and validated in parallel, each into its own lists of students and errors. The lists are
+ * then merged in the order of lines - errors are printed with their line in the whole file, and the students are
+ * stored, so that the result is the same as reading the rows one by one
+ * @param inputPath - the path of the input file
+ * @param fileSize - the size of the input file
+ * @param store - the store of students, initialized
+ * @param numOfThreads - the number of threads to read with
+ */
+void readStudentsInParallel(const char inputPath[], long fileSize, StudentStore* store, int numOfThreads)
+{
+    int fd = open(inputPath, O_RDONLY);
+    char* data = fd < 0 ? MAP_FAILED : (char*)mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (fd >= 0)
+    {
+        close(fd); // the mapping stays valid after closing
+    }
+    if (data == MAP_FAILED)
+    {
+        printf(ERROR_OPEN_INPUT);
+        exit(UNSUCCESSFUL);
+    }
+
+    int numOfChunks = numOfThreads * CHUNKS_PER_THREAD;
+    ReadChunk* chunks = (ReadChunk*)calloc(numOfChunks, sizeof(ReadChunk));
+    if (chunks == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    const char* chunkStart = data;
+    for (int c = 0; c < numOfChunks; c++) // every chunk ends right after an end of line, or at the end of the file
+    {
+        const char* chunkEnd = data + fileSize * (c + 1) / numOfChunks;
+        if (chunkEnd < chunkStart)
+        {
+            chunkEnd = chunkStart;
+        }
+        else if (chunkEnd > data && chunkEnd < data + fileSize && chunkEnd[-1] != END_OF_LINE)
+        {
+            const char* lineEnd = memchr(chunkEnd, END_OF_LINE, data + fileSize - chunkEnd);
+            chunkEnd = lineEnd == NULL ? data + fileSize : lineEnd + 1;
+        }
+        chunks[c].start = chunkStart;
+        chunks[c].end = chunkEnd;
+        chunks[c].studentsCapacity = INITIAL_CAPACITY; // grows while parsing, like the store
+        chunks[c].students = (StudentRow*)resizeColumn(NULL, sizeof(StudentRow), chunks[c].studentsCapacity);
+        chunks[c].errorsCapacity = INITIAL_CAPACITY;
+        chunks[c].errors = (RowError*)resizeColumn(NULL, sizeof(RowError), chunks[c].errorsCapacity);
+        chunkStart = chunkEnd;
+    }
+
+    getClassifyFunc(); // choose the classifier before the threads use it
+    ReadTask tasks[MAX_NUM_OF_THREADS];
+    pthread_t threads[MAX_NUM_OF_THREADS];
+    int isRunning[MAX_NUM_OF_THREADS];
+    for (int t = 0; t < numOfThreads; t++) // thread t parses chunks t, t + n, t + 2n...
+    {
+        tasks[t].chunks = chunks;
+        tasks[t].first = t;
+        tasks[t].numOfChunks = numOfChunks;
+        tasks[t].step = numOfThreads;
+    }
+    for (int t = 1; t < numOfThreads; t++) // if a thread can't be created, its chunks are parsed at the end
+    {
+        isRunning[t] = !pthread_create(&threads[t], NULL, runReadTask, &tasks[t]);
+    }
+    runReadTask(&tasks[0]);
+    for (int t = 1; t < numOfThreads; t++)
+    {
+        if (isRunning[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+        else
+        {
+            runReadTask(&tasks[t]);
+        }
+    }
+
+    int firstLine = 0;
+    int reachedQuit = 0;
+    for (int c = 0; c < numOfChunks; c++) // chunks after a quit row are ignored
+    {
+        ReadChunk* chunk = &chunks[c];
+        int e = 0;
+        for (int i = 0; i <= chunk->numOfStudents && !reachedQuit; i++) // errors and students in the order of lines
+        {
+            int lineNum = i < chunk->numOfStudents ? chunk->students[i].lineNum : chunk->numOfLines;
+            for (; e < chunk->numOfErrors && chunk->errors[e].lineNum < lineNum; e++)
+            {
+                printf("%s", chunk->errors[e].msg);
+                printf(IN_LINE_N_MSG, firstLine + chunk->errors[e].lineNum);
+            }
+            if (i < chunk->numOfStudents)
+            {
+                chunk->students[i].lineNum += firstLine;
+                storeStudent(&chunk->students[i], store);
+            }
+        }
+        firstLine += chunks[c].numOfLines;
+        reachedQuit = reachedQuit || chunks[c].reachedQuit;
+        free(chunks[c].students);
+        free(chunks[c].errors);
+    }
+
+    free(chunks);
+    munmap(data, fileSize);
+}
+
+
+/**
+ * This function reads the students either interactively or from an input file, and passes every valid student on
+ * @param inputPath - the path of the input file, NULL for reading interactively from the user
+ * @param onStudent - the function which receives every valid student
+ * @param context - passed to onStudent
+ */
+void readRows(const char inputPath[], StudentFunc onStudent, void* context)
+{
+    if (inputPath == NULL)
+    {
+        readRowsInteractively(onStudent, context);
+        return;
+    }
+    readRowsFromFile(inputPath, onStudent, context);
+}
+
+
+/**
+ * This function reads the students either interactively or from an input file into a new store. For a file, the
+ * capacity of the store is reserved according to the size of the file, and a big file is read on several threads
+ * @param inputPath - the path of the input file, NULL for reading interactively from the user
+ * @param store - the store of students to initialize
+ * @param numOfThreads - the number of threads to read a file with
+ * @param duplicateMode - what to do with students whose id was already read
+ */
+void readStudents(const char inputPath[], StudentStore* store, int numOfThreads, int duplicateMode)
+{
+    long fileSize = 0;
+    if (inputPath != NULL) // every valid row takes at least MIN_BYTES_PER_ROW bytes, so the size bounds the students
+    {
+        FILE* inputFile = openInputFile(inputPath);
+        fseek(inputFile, 0, SEEK_END);
+        fileSize = ftell(inputFile);
+        fclose(inputFile);
+    }
+    initStudentStore(store, fileSize > 0 ? fileSize / MIN_BYTES_PER_ROW : 0);
+    store->duplicateMode = duplicateMode;
+    if (duplicateMode != KEEP_DUPLICATES)
+    {
+        initIdIndex(&store->idIndex, fileSize / MIN_BYTES_PER_ROW);
+    }
+    if (numOfThreads > 1 && fileSize >= MIN_PARALLEL_READ_SIZE)
+    {
+        readStudentsInParallel(inputPath, fileSize, store, numOfThreads);
+        return;
+    }
+    readRows(inputPath, storeStudent, store);
+}
+
+
+/**
+ * This function checks if the first student is better than the second one - has a higher grade/age value, or
+ * the same value and appeared earlier
+ * @param first - first student
+ * @param second - second student
+ * @return 1 if the first student is better, 0 otherwise
+ */
+int isBetterStudent(const RankedStudent* first, const RankedStudent* second)
+{
+    // compare grade1 / age1 with grade2 / age2 exactly, without dividing (ages are positive)
+    int firstValue = first->grade * second->age;
+    int secondValue = second->grade * first->age;
+    if (firstValue != secondValue)
+    {
+        return firstValue > secondValue;
+    }
+    return first->sequence < second->sequence;
+}
+
+
+/**
+ * This function moves a student down the heap of best students until both its children are better than it
+ * @param top - the best students
+ * @param root - the index of the student to move down
+ */
+void siftDownWorst(TopStudents* top, int root)
+{
+    RankedStudent* heap = top->heap;
+    while (2 * root + 1 < top->size)
+    {
+        int child = 2 * root + 1;
+        if (child + 1 < top->size && isBetterStudent(&heap[child], &heap[child + 1]))
+        {
+            child++; // the worse child
+        }
+        if (!isBetterStudent(&heap[root], &heap[child]))
+        {
+            return;
+        }
+        RankedStudent temp = heap[root];
+        heap[root] = heap[child];
+        heap[child] = temp;
+        root = child;
+    }
+}
+
+
+/**
+ * This function copies a string of a student row
+ * @param target - the target string, MAX_FIELD_LEN characters long
+ * @param str - the string (not necessarily null terminated)
+ * @param len - the number of characters in the string
+ */
+void copyField(char target[], const char str[], int len)
+{
+    memcpy(target, str, len);
+    target[len] = '\0';
+}
+
+
+/**
+ * This function offers a student to the best students seen so far. The student is kept only if it is better than
+ * the worst of them, or if there are less best students than needed
+ * @param student - the validated row of the student
+ * @param context - the best students
+ */
+void offerStudent(const StudentRow* student, void* context)
+{
+    TopStudents* top = (TopStudents*)context;
+    RankedStudent candidate;
+    candidate.grade = student->grade;
+    candidate.age = student->age;
+    candidate.sequence = top->numOfSeen++;
+
+    int slot = 0;
+    if (top->size < top->capacity) // not enough best students yet - add at the bottom and move up
+    {
+        slot = top->size++;
+        while (slot > 0 && isBetterStudent(&top->heap[(slot - 1) / 2], &candidate))
+        {
+            top->heap[slot] = top->heap[(slot - 1) / 2];
+            slot = (slot - 1) / 2;
+        }
+    }
+    else if (!isBetterStudent(&candidate, &top->heap[0])) // not better than the worst of the best
+    {
+        return;
+    }
+
+    RankedStudent* kept = &top->heap[slot];
+    *kept = candidate;
+    kept->id = student->id;
+    copyField(kept->name, student->name, student->nameLen);
+    copyField(kept->country, student->country, student->countryLen);
+    copyField(kept->city, student->city, student->cityLen);
+    if (slot == 0 && top->size == top->capacity)
+    {
+        siftDownWorst(top, 0);
+    }
+}
+
+
+/**
+ * This function initializes an empty collection of best students
+ * @param top - the best students (the caller should free the heap)
+ * @param k - the number of best students to keep
+ */
+void initTopStudents(TopStudents* top, int k)
+{
+    top->heap = (RankedStudent*)malloc(k * sizeof(RankedStudent));
+    if (top->heap == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    top->size = 0;
+    top->capacity = k;
+    top->numOfSeen = 0;
+}
+
+
+/**
+ * This function orders the best students from the best one, after all the students were offered
+ * @param top - the best students
+ */
+void orderTopStudents(TopStudents* top)
+{
+    // remove the worst student until the heap is empty - this places the students from the best one
+    int size = top->size;
+    while (top->size > 1)
+    {
+        RankedStudent worst = top->heap[0];
+        top->heap[0] = top->heap[top->size - 1];
+        top->size--;
+        siftDownWorst(top, 0);
+        top->heap[top->size] = worst;
+    }
+    top->size = size;
+}
+
+
+/**
+ * This function finds the best students while the input is read, without keeping the other students
+ * @param inputPath - the path of the input file, NULL for reading interactively from the user
+ * @param k - the number of best students to find
+ * @param top - the best students, ordered from the best when the input ends (the caller should free the heap)
+ */
+void findTopStudents(const char inputPath[], int k, TopStudents* top)
+{
+    initTopStudents(top, k);
+    readRows(inputPath, offerStudent, top);
+    orderTopStudents(top);
+}
+
+
+/**
+ * This function finds the best students of a store
+ * @param store - the store of students
+ * @param k - the number of best students to find
+ * @param top - the best students, ordered from the best (the caller should free the heap)
+ */
+void findTopStoredStudents(const StudentStore* store, int k, TopStudents* top)
+{
+    initTopStudents(top, k);
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        StudentRow student;
+        student.id = store->ids[i];
+        student.grade = store->grades[i];
+        student.age = store->ages[i];
+        student.name = getName(store, i);
+        student.nameLen = (int)strlen(student.name);
+        student.country = store->pool.data + store->countryOffsets[i];
+        student.countryLen = (int)strlen(student.country);
+        student.city = store->pool.data + store->cityOffsets[i];
+        student.cityLen = (int)strlen(student.city);
+        offerStudent(&student, top);
+    }
+    orderTopStudents(top);
+}
+
+
+/**
+ * This function prints a kept student
+ * @param format - the format to print the student with
+ * @param student - the student
+ */
+void printRankedStudent(const char format[], const RankedStudent* student)
+{
+    printf(format, student->id, student->name, student->grade, student->age, student->country, student->city);
+}
+
+
+/**
+ * This function looks for a student with a higher grade/age value than the best one, one student at a time.
+ * The values are compared exactly: grade1 / age1 > grade2 / age2 exactly when grade1 * age2 > grade2 * age1
+ * @param store - the store of students
+ * @param start - the first student to check
+ * @param end - the student after the last one to check
+ * @param bestStudentIndex - the index of the best student so far
+ * @return The index of the best student, the first one if several share the highest value
+ */
+int findBetterStudent(const StudentStore* store, int start, int end, int bestStudentIndex)
+{
+    int bestGrade = store->grades[bestStudentIndex];
+    int bestAge = store->ages[bestStudentIndex];
+    for (int j = start; j < end; j++)
+    {
+        if (store->grades[j] * bestAge > bestGrade * store->ages[j])
+        {
+            bestStudentIndex = j;
+            bestGrade = store->grades[j];
+            bestAge = store->ages[j];
+        }
+    }
+    return bestStudentIndex;
+}
+
+
+/**
+ * This function checks which student has the highest grade/age value. The values are compared exactly in integers.
+ * With SSE2, 16 students are compared with the best one at a time, and only a group which contains a better
+ * student is checked one student at a time
+ * @param store - the store of students
+ * @return The index in the store of the student with the highest grade/age value (the first one if several share
+ * it)
+ */
+int findBestStudent(const StudentStore* store)
+{
+    int bestStudentIndex = 0;
+    int j = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; j + SSE_WIDTH <= store->numOfStudents; j += SSE_WIDTH)
+    {
+        // products are at most 100 * 120, so they fit in 16 bit lanes
+        __m128i bestGrade = _mm_set1_epi16(store->grades[bestStudentIndex]);
+        __m128i bestAge = _mm_set1_epi16(store->ages[bestStudentIndex]);
+        __m128i grades = _mm_loadu_si128((const __m128i*)(store->grades + j));
+        __m128i ages = _mm_loadu_si128((const __m128i*)(store->ages + j));
+
+        __m128i lowBetter = _mm_cmpgt_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(grades, zero), bestAge),
+                                            _mm_mullo_epi16(_mm_unpacklo_epi8(ages, zero), bestGrade));
+        __m128i highBetter = _mm_cmpgt_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(grades, zero), bestAge),
+                                             _mm_mullo_epi16(_mm_unpackhi_epi8(ages, zero), bestGrade));
+        if (_mm_movemask_epi8(_mm_or_si128(lowBetter, highBetter))) // some student here is better
+        {
+            bestStudentIndex = findBetterStudent(store, j, j + SSE_WIDTH, bestStudentIndex);
+        }
+    }
+#endif
+
+    return findBetterStudent(store, j, store->numOfStudents, bestStudentIndex);
+}
+
+/**
+ * This function initializes an empty table of groups
+ * @param table - the table
+ * @param field - the field to group by, COUNTRY_FIELD or CITY_FIELD
+ * @param places - the store the places are interned in
+ */
+void initGroupTable(GroupTable* table, int field, StudentStore* places)
+{
+    table->capacity = INITIAL_GROUPS_CAPACITY * GROWTH_FACTOR;
+    table->slots = (uint32_t*)calloc(table->capacity, sizeof(uint32_t));
+    table->groupsCapacity = INITIAL_GROUPS_CAPACITY;
+    table->groups = (GroupStats*)malloc(table->groupsCapacity * sizeof(GroupStats));
+    table->numOfGroups = 0;
+    table->field = field;
+    table->places = places;
+    if (table->slots == NULL || table->groups == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+}
+
+
+/**
+ * @param place - the offset of a place in the pool
+ * @param capacity - the capacity of the table, a power of 2
+ * @return the first slot to look for the place in
+ */
+uint32_t groupSlot(uint32_t place, uint32_t capacity)
+{
+    uint32_t hash = place * GROUP_HASH_MULTIPLIER; // offsets are spread by multiplying, then the high bits mixed in
+    return (hash ^ (hash >> GROUP_HASH_SHIFT)) & (capacity - 1);
+}
+
+
+/**
+ * This function doubles the number of groups the table can hold, and inserts all the groups again
+ * @param table - the table
+ */
+void growGroupTable(GroupTable* table)
+{
+    table->groupsCapacity *= GROWTH_FACTOR;
+    table->groups = (GroupStats*)resizeColumn(table->groups, sizeof(GroupStats), table->groupsCapacity);
+
+    free(table->slots);
+    table->capacity *= GROWTH_FACTOR;
+    table->slots = (uint32_t*)calloc(table->capacity, sizeof(uint32_t));
+    if (table->slots == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    for (int i = 0; i < table->numOfGroups; i++)
+    {
+        uint32_t slot = groupSlot(table->groups[i].place, table->capacity);
+        while (table->slots[slot] != EMPTY_SLOT) // linear probing
+        {
+            slot = (slot + 1) & (table->capacity - 1);
+        }
+        table->slots[slot] = i + 1;
+    }
+}
+
+
+/**
+ * This function finds the group of a place, and adds an empty group if it is the first student of the place
+ * @param table - the table
+ * @param place - the offset of the place in the pool
+ * @return the group
+ */
+GroupStats* findGroup(GroupTable* table, uint32_t place)
+{
+    uint32_t slot = groupSlot(place, table->capacity);
+    while (table->slots[slot] != EMPTY_SLOT) // linear probing
+    {
+        GroupStats* group = &table->groups[table->slots[slot] - 1];
+        if (group->place == place)
+        {
+            return group;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    if (table->numOfGroups == table->groupsCapacity) // the table is kept at most half full
+    {
+        growGroupTable(table);
+        return findGroup(table, place);
+    }
+    GroupStats* group = &table->groups[table->numOfGroups++];
+    memset(group, 0, sizeof(GroupStats));
+    group->place = place;
+    group->minGrade = HIGHEST_GRADE;
+    table->slots[slot] = table->numOfGroups;
+    return group;
+}
+
+
+/**
+ * This function adds a student to the statistics of its group
+ * @param table - the table
+ * @param place - the offset of the country or city of the student in the pool
+ * @param id - the id of the student
+ * @param grade - the grade of the student
+ * @param age - the age of the student
+ */
+void addToGroup(GroupTable* table, uint32_t place, uint64_t id, int grade, int age)
+{
+    GroupStats* group = findGroup(table, place);
+    group->gradesSum += grade;
+    group->minGrade = grade < group->minGrade ? grade : group->minGrade;
+    group->maxGrade = grade > group->maxGrade ? grade : group->maxGrade;
+    if (group->count == 0 || grade * group->bestAge > group->bestGrade * age) // exact comparison of grade / age
+    {
+        group->bestGrade = grade;
+        group->bestAge = age;
+        group->bestId = id;
+    }
+    group->count++;
+}
+
+
+/**
+ * This function adds a student which was just read to its group - the place of the student is interned, so that
+ * the group can be found by its offset
+ * @param student - the student
+ * @param context - the table of groups
+ */
+void groupStudent(const StudentRow* student, void* context)
+{
+    GroupTable* table = (GroupTable*)context;
+    uint32_t place = table->field == COUNTRY_FIELD ?
+                     internString(table->places, student->country, student->countryLen) :
+                     internString(table->places, student->city, student->cityLen);
+    addToGroup(table, place, student->id, student->grade, student->age);
+}
+
+
+/**
+ * This function groups the students of a store
+ * @param store - the store of students
+ * @param table - an empty table of groups
+ */
+void groupStoredStudents(const StudentStore* store, GroupTable* table)
+{
+    const uint32_t* places = table->field == COUNTRY_FIELD ? store->countryOffsets : store->cityOffsets;
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        addToGroup(table, places[i], store->ids[i], store->grades[i], store->ages[i]);
+    }
+}
+
+
+/**
+ * This function prints the statistics of every group, in the order the groups were first seen
+ * @param table - the table of groups
+ * @param pool - the data of the pool the places are in
+ */
+void printGroups(const GroupTable* table, const char pool[])
+{
+    for (int i = 0; i < table->numOfGroups; i++)
+    {
+        const GroupStats* group = &table->groups[i];
+        printf(GROUP_INFO, pool + group->place, group->count, (double)group->gradesSum / group->count,
+               group->minGrade, group->maxGrade, (double)group->bestGrade / group->bestAge, group->bestId);
+    }
+}
+
+
+/**
+ * This function frees the memory of a table of groups
+ * @param table - the table
+ */
+void freeGroupTable(GroupTable* table)
+{
+    free(table->slots);
+    free(table->groups);
+}
+
+
+/**
+ * This function compares between two names, and checks which one is "higher" according to alphabetic order
+ * @param name1 - first name to compare
+ * @param name2 - second name to compare
+ * @return 1 if the first name is "higher", 2 if the second name is "higher"
+ */
+int compareNames(const char name1[], const char name2[])
+{
+    int name1Len = (int)strlen(name1);
+    for (int i = 0; i < name1Len; i++)
+    {
+        if(name1[i] > name2[i])
+        {
+            return FIRST;
+        }
+        if (name1[i] < name2[i])
+        {
+            return SECOND;
+        }
+    }
+
+    return SECOND;
+}
+
+
+/**
+ * This function checks if the name of the first entry is "higher" than the name of the second entry. Names with
+ * different prefixes are compared by a single integer comparison. Equal prefixes which end with a zero are of equal
+ * names (names don't contain zeros), so only names which share all the prefix are compared character by character
+ * @param first - first name entry
+ * @param second - second name entry
+ * @param names - the data of the pool the names are in
+ * @return 1 if the first name is "higher", 0 otherwise
+ */
+int isNameHigher(const NameEntry* first, const NameEntry* second, const char names[])
+{
+    if (first->prefix != second->prefix)
+    {
+        return first->prefix > second->prefix;
+    }
+    if ((first->prefix & LAST_BYTE_MASK) == 0)
+    {
+        return 0;
+    }
+    return compareNames(names + first->offset + NAME_PREFIX_LEN, names + second->offset + NAME_PREFIX_LEN) == FIRST;
+}
+
+
+/**
+ * This function swaps two name entries
+ * @param first - first name entry
+ * @param second - second name entry
+ */
+void swapEntries(NameEntry* first, NameEntry* second)
+{
+    NameEntry temp = *first;
+    *first = *second;
+    *second = temp;
+}
+
+
+/**
+ * This function finds which of three entries has the median name
+ * @param entries - array of name entries
+ * @param a - index of the first entry
+ * @param b - index of the second entry
+ * @param c - index of the third entry
+ * @param names - the data of the pool the names are in
+ * @return the index of the entry with the median name
+ */
+int medianOfThree(const NameEntry entries[], int a, int b, int c, const char names[])
+{
+    if (isNameHigher(&entries[a], &entries[b], names))
+    {
+        if (isNameHigher(&entries[b], &entries[c], names))
+        {
+            return b;
+        }
+        return isNameHigher(&entries[a], &entries[c], names) ? c : a;
+    }
+    if (isNameHigher(&entries[a], &entries[c], names))
+    {
+        return a;
+    }
+    return isNameHigher(&entries[b], &entries[c], names) ? c : b;
+}
+
+
+/**
+ * This function chooses the pivot of a part of the array - the median of the first, middle and last entries,
+ * or for big parts the median of three such medians (ninther)
+ * @param entries - array of name entries
+ * @param left - left index of the part
+ * @param right - right index of the part
+ * @param names - the data of the pool the names are in
+ * @return the index of the pivot
+ */
+int choosePivot(const NameEntry entries[], int left, int right, const char names[])
+{
+    int middle = left + (right - left) / 2;
+    if (right - left + 1 < NINTHER_THRESHOLD)
+    {
+        return medianOfThree(entries, left, middle, right, names);
+    }
+
+    int step = (right - left) / 8;
+    int first = medianOfThree(entries, left, left + step, left + 2 * step, names);
+    int second = medianOfThree(entries, middle - step, middle, middle + step, names);
+    int third = medianOfThree(entries, right - 2 * step, right - step, right, names);
+    return medianOfThree(entries, first, second, third, names);
+}
+
+
+/**
+ * This function partitions a part of the array around the name of its first entry, so that no entry of the left
+ * part is "higher" than an entry of the right part
+ * @param entries - array of name entries
+ * @param left - left index of the part
+ * @param right - right index of the part
+ * @param names - the data of the pool the names are in
+ * @return the last index of the left part, which is always smaller than right
+ */
+int partition(NameEntry entries[], int left, int right, const char names[])
+{
+    NameEntry pivot = entries[left];
+    int i = left - 1;
+    int j = right + 1;
+
+    while (TRUE)
+    {
+        do
+        {
+            i++;
+        } while (isNameHigher(&pivot, &entries[i], names));
+
+        do
+        {
+            j--;
+        } while (isNameHigher(&entries[j], &pivot, names));
+
+        if (i >= j)
+        {
+            return j;
+        }
+        swapEntries(&entries[i], &entries[j]);
+    }
+}
+
+
+/**
+ * This function sorts a small part of the array according to alphabetic order of name
+ * @param entries - array of name entries
+ * @param left - left index of the part
+ * @param right - right index of the part
+ * @param names - the data of the pool the names are in
+ */
+void insertionSort(NameEntry entries[], int left, int right, const char names[])
+{
+    for (int i = left + 1; i <= right; i++)
+    {
+        NameEntry current = entries[i];
+        int j = i - 1;
+        while (j >= left && isNameHigher(&entries[j], &current, names))
+        {
+            entries[j + 1] = entries[j];
+            j--;
+        }
+        entries[j + 1] = current;
+    }
+}
+
+
+/**
+ * This function moves an entry down the heap until both its children have names which aren't "higher"
+ * @param heap - the heap of name entries
+ * @param root - the index of the entry to move down
+ * @param size - the number of entries in the heap
+ * @param names - the data of the pool the names are in
+ */
+void siftDown(NameEntry heap[], int root, int size, const char names[])
+{
+    while (2 * root + 1 < size)
+    {
+        int child = 2 * root + 1;
+        if (child + 1 < size && isNameHigher(&heap[child + 1], &heap[child], names))
+        {
+            child++;
+        }
+        if (!isNameHigher(&heap[child], &heap[root], names))
+        {
+            return;
+        }
+        swapEntries(&heap[root], &heap[child]);
+        root = child;
+    }
+}
+
+
+/**
+ * This function heap sorts a part of the array according to alphabetic order of name
+ * @param entries - array of name entries
+ * @param left - left index of the part
+ * @param right - right index of the part
+ * @param names - the data of the pool the names are in
+ */
+void heapSort(NameEntry entries[], int left, int right, const char names[])
+{
+    NameEntry* heap = entries + left;
+    int size = right - left + 1;
+    for (int i = size / 2 - 1; i >= 0; i--)
+    {
+        siftDown(heap, i, size, names);
+    }
+    for (int last = size - 1; last > 0; last--)
+    {
+        swapEntries(&heap[0], &heap[last]);
+        siftDown(heap, 0, last, names);
+    }
+}
+
+
+/**
+ * This function sorts an array of name entries according to alphabetic order of name. It is an introsort -
+ * a quick sort with a median of three (or ninther) pivot, which switches to insertion sort for small parts and
+ * to heap sort when the recursion gets too deep. It recurses only into the smaller part, so the depth of the
+ * recursion is logarithmic
+ * @param entries - array of name entries
+ * @param left - left index of array
+ * @param right - right index of array
+ * @param depthLimit - the number of partitions left before switching to heap sort
+ * @param names - the data of the pool the names are in
+ */
+void quickSort(NameEntry entries[], int left, int right, int depthLimit, const char names[])
+{
+    while (right - left + 1 > INSERTION_SORT_CUTOFF) // there is still partitioning to be done
+    {
+        if (depthLimit == 0) // too many bad pivots - bound the worst case
+        {
+            heapSort(entries, left, right, names);
+            return;
+        }
+        depthLimit--;
+
+        swapEntries(&entries[left], &entries[choosePivot(entries, left, right, names)]);
+        int middle = partition(entries, left, right, names);
+        if (middle - left < right - middle)
+        {
+            quickSort(entries, left, middle, depthLimit, names);
+            left = middle + 1;
+        }
+        else
+        {
+            quickSort(entries, middle + 1, right, depthLimit, names);
+            right = middle;
+        }
+    }
+    insertionSort(entries, left, right, names);
+}
+
+
+/**
+ * This function allocates an array of sort entries for all the students in the store
+ * @param numOfStudents - the number of students in the store
+ * @return the array (the caller is responsible for freeing)
+ */
+SortEntry* allocateSortEntries(int numOfStudents)
+{
+    SortEntry* entries = (SortEntry*)malloc((numOfStudents + 1) * sizeof(SortEntry)); // never allocate 0 bytes
+    if (entries == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    return entries;
+}
+
+
+/**
+ * This function counts the students of each grade in a range of the store
+ * @param arg - the counting task
+ * @return NULL
+ */
+void* runGradeCountTask(void* arg)
+{
+    GradeCountTask* task = (GradeCountTask*)arg;
+    memset(task->positions, 0, sizeof(task->positions));
+    for (int i = task->start; i < task->end; i++)
+    {
+        task->positions[task->store->grades[i] - LOWEST_GRADE]++;
+    }
+    return NULL;
+}
+
+
+/**
+ * This function places the students of a range of the store in their positions, in their original order
+ * @param arg - the counting task, whose positions are the first position of each grade for this range
+ * @return NULL
+ */
+void* runGradeScatterTask(void* arg)
+{
+    GradeCountTask* task = (GradeCountTask*)arg;
+    for (int i = task->start; i < task->end; i++)
+    {
+        SortEntry* entry = &task->entries[task->positions[task->store->grades[i] - LOWEST_GRADE]++];
+        entry->key = task->store->grades[i];
+        entry->index = i;
+    }
+    return NULL;
+}
+
+
+/**
+ * This function runs one task on every thread, where the current thread runs the first task
+ * @param run - the function which runs a task
+ * @param tasks - the tasks
+ * @param numOfThreads - the number of threads, and of tasks
+ */
+void runCountTasks(void* (*run)(void*), GradeCountTask tasks[], int numOfThreads)
+{
+    pthread_t threads[MAX_NUM_OF_THREADS];
+    int isRunning[MAX_NUM_OF_THREADS];
+    for (int t = 1; t < numOfThreads; t++) // if a thread can't be created, its task is run at the end
+    {
+        isRunning[t] = !pthread_create(&threads[t], NULL, run, &tasks[t]);
+    }
+    run(&tasks[0]);
+    for (int t = 1; t < numOfThreads; t++)
+    {
+        if (isRunning[t])
+        {
+            pthread_join(threads[t], NULL);
+        }
+        else
+        {
+            run(&tasks[t]);
+        }
+    }
+}
+
+
+/**
+ * This function sorts the students according to their grades by counting the students of each grade, and then
+ * placing every student directly in its position. The sort is stable - it keeps students with equal grades in
+ * their original order. Every thread counts and places a consecutive range of the students, and the students of
+ * a grade are placed range after range, so the order is the same as on a single thread
+ * @param store - the store of students
+ * @param entries - output array of sort entries, at least as long as the number of students
+ * @param numOfThreads - the number of threads to sort with
+ */
+void countingSortByGrade(const StudentStore* store, SortEntry entries[], int numOfThreads)
+{
+    GradeCountTask tasks[MAX_NUM_OF_THREADS];
+    if (store->numOfStudents < MIN_PARALLEL_SORT_SIZE)
+    {
+        numOfThreads = 1;
+    }
+    for (int t = 0; t < numOfThreads; t++)
+    {
+        tasks[t].store = store;
+        tasks[t].entries = entries;
+        tasks[t].start = (int)((long)store->numOfStudents * t / numOfThreads);
+        tasks[t].end = (int)((long)store->numOfStudents * (t + 1) / numOfThreads);
+    }
+    runCountTasks(runGradeCountTask, tasks, numOfThreads);
+
+    int position = 0;
+    for (int grade = 0; grade < NUM_OF_GRADES; grade++) // turn the counts into the first position of each range
+    {
+        for (int t = 0; t < numOfThreads; t++)
+        {
+            int count = tasks[t].positions[grade];
+            tasks[t].positions[grade] = position;
+            position += count;
+        }
+    }
+
+    runCountTasks(runGradeScatterTask, tasks, numOfThreads);
+}
+
+
+/**
+ * This function sorts the students according to their grades, by counting sort. More than one thread is used if
+ * given
+ * @param store - the store of students
+ * @param numOfThreads - the number of threads to sort with
+ * @return the students sorted by grade (the caller is responsible for freeing)
+ */
+SortEntry* sortByGrade(const StudentStore* store, int numOfThreads)
+{
+    SortEntry* entries = allocateSortEntries(store->numOfStudents);
+    countingSortByGrade(store, entries, numOfThreads);
+    return entries;
+}
+
+
+/**
+ * This function sorts the students according to alphabetic order of name
+ * @param store - the store of students
+ * @return the students sorted by name (the caller is responsible for freeing)
+ */
+SortEntry* sortByName(const StudentStore* store)
+{
+    NameEntry* entries = (NameEntry*)malloc((store->numOfStudents + 1) * sizeof(NameEntry));
+    if (entries == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        entries[i].prefix = store->namePrefixes[i];
+        entries[i].offset = store->nameOffsets[i];
+        entries[i].index = i;
+    }
+
+    int depthLimit = 0;
+    for (int size = store->numOfStudents; size > 1; size /= 2) // depth limit is a multiple of log2 of size
+    {
+        depthLimit += DEPTH_LIMIT_FACTOR;
+    }
+    quickSort(entries, 0, store->numOfStudents - 1, depthLimit, store->pool.data);
+
+    SortEntry* order = allocateSortEntries(store->numOfStudents);
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        order[i].key = entries[i].offset;
+        order[i].index = entries[i].index;
+    }
+    free(entries);
+    return order;
+}
+
+
+/**
+ * This function prints a single student
+ * @param format - the format to print the student with
+ * @param store - the store of students
+ * @param i - the index of the student
+ */
+void printStudent(const char format[], const StudentStore* store, int i)
+{
+    printf(format, store->ids[i], getName(store, i), store->grades[i], store->ages[i],
+           store->pool.data + store->countryOffsets[i], store->pool.data + store->cityOffsets[i]);
+}
+
+
+/**
+ * This function writes the content of the output buffer to the standard output, and empties the buffer
+ * @param output - the output buffer
+ */
+void flushOutput(OutputBuffer* output)
+{
+    int written = 0;
+    while (written < output->len)
+    {
+        ssize_t result = write(STDOUT_FILENO, output->data + written, output->len - written);
+        if (result < 0 && errno == EINTR) // interrupted before anything was written - try again
+        {
+            continue;
+        }
+        if (result <= 0) // the output can't be written, report it where it can still be seen
+        {
+            fprintf(stderr, ERROR_WRITE_OUTPUT);
+            exit(UNSUCCESSFUL);
+        }
+        written += (int)result;
+    }
+    output->len = 0;
+}
+
+
+/**
+ * This function appends a string to the output buffer
+ * @param output - the output buffer, with room for the string
+ * @param str - the string
+ */
+void appendString(OutputBuffer* output, const char str[])
+{
+    int len = (int)strlen(str);
+    memcpy(output->data + output->len, str, len);
+    output->len += len;
+}
+
+
+/**
+ * This function appends the decimal digits of a number to the output buffer
+ * @param output - the output buffer, with room for the number
+ * @param number - the number
+ */
+void appendNumber(OutputBuffer* output, uint64_t number)
+{
+    char digits[MAX_DIGITS];
+    int numOfDigits = 0;
+    do // the digits are found from the last one
+    {
+        digits[MAX_DIGITS - 1 - numOfDigits] = (char)('0' + number % BASE);
+        number /= BASE;
+        numOfDigits++;
+    } while (number > 0);
+    memcpy(output->data + output->len, digits + MAX_DIGITS - numOfDigits, numOfDigits);
+    output->len += numOfDigits;
+}
+
+
+/**
+ * This function appends a single character to the output buffer
+ * @param output - the output buffer, with room for the character
+ * @param c - the character
+ */
+void appendChar(OutputBuffer* output, char c)
+{
+    output->data[output->len++] = c;
+}
+
+
+/**
+ * This function appends the row of a student to the output buffer, the same way as FORMAT_OF_FIELDS_PRINT
+ * @param output - the output buffer, with room for the row
+ * @param store - the store of students
+ * @param student - the index of the student
+ */
+void appendStudentRow(OutputBuffer* output, const StudentStore* store, int student)
+{
+    appendNumber(output, store->ids[student]);
+    appendChar(output, FIELDS_DELIMITER);
+    appendString(output, getName(store, student));
+    appendChar(output, FIELDS_DELIMITER);
+    appendNumber(output, store->grades[student]);
+    appendChar(output, FIELDS_DELIMITER);
+    appendNumber(output, store->ages[student]);
+    appendChar(output, FIELDS_DELIMITER);
+    appendString(output, store->pool.data + store->countryOffsets[student]);
+    appendChar(output, FIELDS_DELIMITER);
+    appendString(output, store->pool.data + store->cityOffsets[student]);
+    appendChar(output, END_OF_LINE);
+}
+
+
+/**
+ * This function prints the students in the given order. The rows are formatted into a big buffer, which is written
+ * with a single call whenever it fills up
+ * @param store - the store of students
+ * @param order - sorted entries of the students to print
+ * @param numOfStudents - the number of students to print
+ */
+void printStudents(const StudentStore* store, const SortEntry order[], int numOfStudents)
+{
+    OutputBuffer output;
+    output.data = (char*)malloc(OUTPUT_BUFFER_SIZE);
+    output.len = 0;
+    if (output.data == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    fflush(stdout); // anything printed before must come first
+
+    for (int i = 0; i < numOfStudents; i++)
+    {
+        if (output.len > OUTPUT_BUFFER_SIZE - MAX_OUTPUT_ROW_LEN) // make sure the next row fits
+        {
+            flushOutput(&output);
+        }
+        appendStudentRow(&output, store, order[i].index);
+    }
+
+    flushOutput(&output);
+    free(output.data);
+}
+
+
+/**
+ * This function empties a store of students, keeping its memory for the next students
+ * @param store - the store of students
+ */
+void clearStudentStore(StudentStore* store)
+{
+    store->numOfStudents = 0;
+    store->pool.size = 0;
+    memset(store->places.slots, 0, store->places.capacity * sizeof(uint32_t));
+    store->places.numOfEntries = 0;
+}
+
+
+/**
+ * This function writes records to the temporary file of a run, and empties the buffer of records
+ * @param run - the file of the run
+ * @param records - the buffer of records
+ */
+void writeRecords(FILE* run, OutputBuffer* records)
+{
+    if (fwrite(records->data, 1, records->len, run) != (size_t)records->len)
+    {
+        printf(ERROR_TEMP_FILE);
+        exit(UNSUCCESSFUL);
+    }
+    records->len = 0;
+}
+
+
+/**
+ * This function sets the header of a record - the grade of the student and the length of its row
+ * @param header - the header of the record
+ * @param grade - the grade of the student
+ * @param rowLen - the number of characters in the row of the student
+ */
+void setRecordHeader(char header[], int grade, int rowLen)
+{
+    header[0] = (char)grade;
+    header[1] = (char)(rowLen >> BITS_IN_BYTE);
+    header[2] = (char)(rowLen & LAST_BYTE_MASK);
+}
+
+
+/**
+ * This function adds a new run at the end of the runs
+ * @param sorter - the external sort
+ * @param run - the file of the run, at its start
+ * @param level - the number of merges the run went through
+ */
+void addRun(ExternalSort* sorter, FILE* run, int level)
+{
+    if (sorter->numOfRuns == sorter->runsCapacity)
+    {
+        sorter->runsCapacity = sorter->runsCapacity > 0 ? sorter->runsCapacity * GROWTH_FACTOR : INITIAL_CAPACITY;
+        sorter->runs = (FILE**)resizeColumn(sorter->runs, sizeof(FILE*), sorter->runsCapacity);
+        sorter->runLevels = (int*)resizeColumn(sorter->runLevels, sizeof(int), sorter->runsCapacity);
+    }
+    sorter->runs[sorter->numOfRuns] = run;
+    sorter->runLevels[sorter->numOfRuns] = level;
+    sorter->numOfRuns++;
+}
+
+
+/**
+ * @return a new temporary file for a run
+ */
+FILE* createRunFile(void)
+{
+    FILE* run = tmpfile();
+    if (run == NULL)
+    {
+        printf(ERROR_TEMP_FILE);
+        exit(UNSUCCESSFUL);
+    }
+    return run;
+}
+
+
+/**
+ * This function finishes writing a run, and moves back to its start for reading
+ * @param run - the file of the run
+ */
+void finishRunFile(FILE* run)
+{
+    if (fflush(run) != 0)
+    {
+        printf(ERROR_TEMP_FILE);
+        exit(UNSUCCESSFUL);
+    }
+    rewind(run);
+}
+
+
+/**
+ * This function moves a run to its next record, reading the next block of the run when the record isn't all in
+ * memory. A run which has no more records is marked as exhausted
+ * @param reader - the reader of the run
+ */
+void advanceRun(RunReader* reader)
+{
+    reader->pos += reader->rowLen + (reader->row != NULL ? RECORD_HEADER_LEN : 0);
+    int needed = RECORD_HEADER_LEN;
+    for (int pass = 0; pass < 2; pass++) // the header, and then the row
+    {
+        if (reader->len - reader->pos < needed) // read the next block after what is left of this one
+        {
+            memmove(reader->data, reader->data + reader->pos, reader->len - reader->pos);
+            reader->len -= reader->pos;
+            reader->pos = 0;
+            reader->len += (int)fread(reader->data + reader->len, 1, RUN_BUFFER_SIZE - reader->len, reader->file);
+            if (reader->len < needed)
+            {
+                reader->isExhausted = TRUE;
+                return;
+            }
+        }
+        const unsigned char* header = (const unsigned char*)reader->data + reader->pos;
+        reader->grade = header[0];
+        reader->rowLen = (header[1] << BITS_IN_BYTE) | header[2];
+        needed = RECORD_HEADER_LEN + reader->rowLen;
+    }
+    reader->row = reader->data + reader->pos + RECORD_HEADER_LEN;
+}
+
+
+/**
+ * This function checks if the current record of the first run comes before the current record of the second run.
+ * Records are ordered by grade, and records of equal grades by run, so that the merge is stable
+ * @param readers - the readers of the runs
+ * @param first - the first run
+ * @param second - the second run
+ * @return 1 if the record of the first run comes first, 0 otherwise
+ */
+int isRunBefore(const RunReader readers[], int first, int second)
+{
+    if (readers[first].isExhausted || readers[second].isExhausted)
+    {
+        return !readers[first].isExhausted;
+    }
+    if (readers[first].grade != readers[second].grade)
+    {
+        return readers[first].grade < readers[second].grade;
+    }
+    return first < second;
+}
+
+
+/**
+ * This function moves the run of a leaf of a loser tree up to the root. Every node on the way keeps the loser of
+ * its match, and the winner goes on. A node of -1 hasn't played yet and wins every match, which builds the tree
+ * when all the runs are adjusted in turn
+ * @param tree - the loser tree, the winner at index 0 and the internal nodes at 1 to numOfRuns - 1
+ * @param numOfRuns - the number of runs
+ * @param run - the run whose record changed
+ * @param readers - the readers of the runs
+ */
+void adjustLoserTree(int tree[], int numOfRuns, int run, const RunReader readers[])
+{
+    for (int node = (run + numOfRuns) / 2; node > 0; node /= 2)
+    {
+        if (run != NOT_FOUND && (tree[node] == NOT_FOUND || isRunBefore(readers, tree[node], run)))
+        {
+            int winner = tree[node];
+            tree[node] = run;
+            run = winner;
+        }
+    }
+    tree[0] = run;
+}
+
+
+/**
+ * This function merges sorted runs, using a loser tree - every record is found by log(number of runs) matches on
+ * the way from its run to the root. The files of the runs are closed
+ * @param runs - the files of the runs, in the order of the input
+ * @param numOfRuns - the number of runs
+ * @param target - the file of the merged run, or NULL for printing the rows to the standard output
+ */
+void mergeRuns(FILE* runs[], int numOfRuns, FILE* target)
+{
+    RunReader* readers = (RunReader*)calloc(numOfRuns, sizeof(RunReader));
+    int* tree = (int*)malloc((numOfRuns + 1) * sizeof(int));
+    if (readers == NULL || tree == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    for (int r = 0; r < numOfRuns; r++)
+    {
+        readers[r].file = runs[r];
+        readers[r].data = (char*)resizeColumn(NULL, 1, RUN_BUFFER_SIZE);
+        advanceRun(&readers[r]);
+        tree[r] = NOT_FOUND;
+    }
+    for (int r = numOfRuns - 1; r >= 0; r--)
+    {
+        adjustLoserTree(tree, numOfRuns, r, readers);
+    }
+
+    OutputBuffer output;
+    output.data = (char*)resizeColumn(NULL, 1, OUTPUT_BUFFER_SIZE);
+    output.len = 0;
+    fflush(stdout); // anything printed before must come first
+    while (numOfRuns > 0 && !readers[tree[0]].isExhausted)
+    {
+        RunReader* winner = &readers[tree[0]];
+        if (output.len > OUTPUT_BUFFER_SIZE - MAX_OUTPUT_ROW_LEN - RECORD_HEADER_LEN) // make sure the next row fits
+        {
+            if (target != NULL)
+            {
+                writeRecords(target, &output);
+            }
+            else
+            {
+                flushOutput(&output);
+            }
+        }
+        if (target != NULL) // the rows are kept as records
+        {
+            setRecordHeader(output.data + output.len, winner->grade, winner->rowLen);
+            output.len += RECORD_HEADER_LEN;
+        }
+        memcpy(output.data + output.len, winner->row, winner->rowLen);
+        output.len += winner->rowLen;
+        advanceRun(winner);
+        adjustLoserTree(tree, numOfRuns, tree[0], readers);
+    }
+    if (target != NULL)
+    {
+        writeRecords(target, &output);
+    }
+    else
+    {
+        flushOutput(&output);
+    }
+
+    for (int r = 0; r < numOfRuns; r++)
+    {
+        free(readers[r].data);
+        fclose(readers[r].file); // temporary files are removed when they are closed
+    }
+    free(output.data);
+    free(readers);
+    free(tree);
+}
+
+
+/**
+ * This function sorts the students of the store by grade and writes them to a new temporary file, as a sorted run.
+ * Every student is a record of its grade, the length of its row and the row as it is printed. Whenever the last
+ * MERGE_FAN_IN runs went through the same number of merges, they are merged into a single run, so that only a
+ * few files are open and every record is merged a logarithmic number of times
+ * @param sorter - the external sort
+ */
+void spillRun(ExternalSort* sorter)
+{
+    StudentStore* store = &sorter->store;
+    countingSortByGrade(store, sorter->order, 1);
+    FILE* run = createRunFile();
+
+    OutputBuffer records;
+    records.data = sorter->buffer;
+    records.len = 0;
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        if (records.len > RUN_BUFFER_SIZE - MAX_OUTPUT_ROW_LEN - RECORD_HEADER_LEN) // make sure the next record fits
+        {
+            writeRecords(run, &records);
+        }
+        int header = records.len;
+        records.len += RECORD_HEADER_LEN;
+        appendStudentRow(&records, store, sorter->order[i].index);
+        setRecordHeader(records.data + header, store->grades[sorter->order[i].index],
+                        records.len - header - RECORD_HEADER_LEN);
+    }
+    writeRecords(run, &records);
+    finishRunFile(run);
+    addRun(sorter, run, 0);
+    clearStudentStore(store);
+
+    while (sorter->numOfRuns >= MERGE_FAN_IN &&
+           sorter->runLevels[sorter->numOfRuns - MERGE_FAN_IN] == sorter->runLevels[sorter->numOfRuns - 1])
+    {
+        FILE* merged = createRunFile();
+        int level = sorter->runLevels[sorter->numOfRuns - 1];
+        sorter->numOfRuns -= MERGE_FAN_IN;
+        mergeRuns(sorter->runs + sorter->numOfRuns, MERGE_FAN_IN, merged);
+        finishRunFile(merged);
+        addRun(sorter, merged, level + 1);
+    }
+}
+
+
+/**
+ * This function adds a student which was just read to the current run, and spills the run when it is full
+ * @param student - the student
+ * @param context - the external sort
+ */
+void addToRun(const StudentRow* student, void* context)
+{
+    ExternalSort* sorter = (ExternalSort*)context;
+    appendStudent(&sorter->store, student);
+    if (sorter->store.numOfStudents == sorter->maxRowsInMemory)
+    {
+        spillRun(sorter);
+    }
+}
+
+
+/**
+ * This function prints the students sorted by grade without keeping all of them in memory. The students are read
+ * in runs of at most the given number of students, and every run is sorted and spilled to a temporary file. The
+ * runs are then merged, keeping the order of students with equal grades like the in-memory sort
+ * @param inputPath - the path of the input file, NULL for reading interactively from the user
+ * @param maxRowsInMemory - the number of students in a run
+ */
+void sortExternally(const char inputPath[], int maxRowsInMemory)
+{
+    ExternalSort sorter;
+    memset(&sorter, 0, sizeof(sorter));
+    sorter.maxRowsInMemory = maxRowsInMemory;
+    initStudentStore(&sorter.store, maxRowsInMemory);
+    sorter.order = allocateSortEntries(maxRowsInMemory);
+    sorter.buffer = (char*)resizeColumn(NULL, 1, RUN_BUFFER_SIZE);
+
+    readRows(inputPath, addToRun, &sorter);
+    if (sorter.numOfRuns == 0) // everything fits in memory
+    {
+        countingSortByGrade(&sorter.store, sorter.order, 1);
+        printStudents(&sorter.store, sorter.order, sorter.store.numOfStudents);
+    }
+    else
+    {
+        if (sorter.store.numOfStudents > 0)
+        {
+            spillRun(&sorter);
+        }
+        mergeRuns(sorter.runs, sorter.numOfRuns, NULL);
+    }
+
+    free(sorter.runs);
+    free(sorter.runLevels);
+    free(sorter.buffer);
+    free(sorter.order);
+    freeStudentStore(&sorter.store);
+}
+
+
+/**
+ * This function adds a buffer to a checksum, 8 bytes at a time. A last partial word is padded with zeros
+ * @param checksum - the checksum so far
+ * @param data - the buffer
+ * @param size - the number of bytes in the buffer
+ * @return the updated checksum
+ */
+uint64_t updateChecksum(uint64_t checksum, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t))
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, size - i < sizeof(uint64_t) ? size - i : sizeof(uint64_t));
+        checksum = (checksum ^ word) * CHECKSUM_PRIME;
+    }
+    return checksum;
+}
+
+
+/**
+ * @param size - the size of a section of the snapshot
+ * @return the size of the section, padded to the alignment of the snapshot
+ */
+size_t alignSection(size_t size)
+{
+    return (size + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+
+/**
+ * This function finds where the sections of a snapshot are, and points the columns of the store at them
+ * @param store - the store of students, whose number of students and pool size are set
+ * @param payload - the sections of the snapshot
+ * @param hasOrders - 1 if the snapshot contains the orders of the students, 0 otherwise
+ * @return the size of all the sections
+ */
+size_t placeSnapshotSections(StudentStore* store, char* payload, int hasOrders)
+{
+    size_t n = (size_t)store->numOfStudents;
+    size_t offset = 0;
+    store->ids = (uint64_t*)(payload + offset);
+    offset += alignSection(n * sizeof(uint64_t));
+    store->namePrefixes = (uint64_t*)(payload + offset);
+    offset += alignSection(n * sizeof(uint64_t));
+    store->nameOffsets = (uint32_t*)(payload + offset);
+    offset += alignSection(n * sizeof(uint32_t));
+    store->countryOffsets = (uint32_t*)(payload + offset);
+    offset += alignSection(n * sizeof(uint32_t));
+    store->cityOffsets = (uint32_t*)(payload + offset);
+    offset += alignSection(n * sizeof(uint32_t));
+    store->grades = (unsigned char*)(payload + offset);
+    offset += alignSection(n);
+    store->ages = (unsigned char*)(payload + offset);
+    offset += alignSection(n);
+    store->pool.data = payload + offset;
+    offset += alignSection(store->pool.size);
+    if (hasOrders)
+    {
+        store->gradeOrder = (SortEntry*)(payload + offset);
+        offset += n * sizeof(SortEntry);
+        store->nameOrder = (SortEntry*)(payload + offset);
+        offset += n * sizeof(SortEntry);
+    }
+    return offset;
+}
+
+
+/**
+ * This function finds the length of a string of the pool, without reading more than a field can hold
+ * @param pool - the pool, which ends with a null terminator
+ * @param offset - the offset of the string in the pool
+ * @return the length of the string, or 0 if it is outside the pool or longer than MAX_FIELD_LEN - 1 characters
+ */
+int getPooledFieldLen(const StringPool* pool, uint32_t offset)
+{
+    if (offset >= pool->size)
+    {
+        return 0;
+    }
+    size_t maxLen = pool->size - offset < MAX_FIELD_LEN ? pool->size - offset : MAX_FIELD_LEN;
+    const char* end = memchr(pool->data + offset, '\0', maxLen);
+    return end == NULL ? 0 : (int)(end - (pool->data + offset));
+}
+
+
+/**
+ * This function checks if a character may appear in a country or a city (or in a name, with spaces)
+ * @param c - the character
+ * @param allowSpaces - 1 if spaces are allowed, 0 otherwise
+ * @return 1 if the character is allowed, 0 otherwise
+ */
+int isPlaceCharacter(char c, int allowSpaces)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || (allowSpaces && c == ' ');
+}
+
+
+/**
+ * This function checks that a string of the pool is a field validateRow could have accepted - not empty, at most
+ * MAX_FIELD_LEN - 1 characters, and made only of letters, '-' and optionally spaces. As in validateRow the last
+ * character of a city isn't checked, it only has to be something the row splitting could leave there
+ * @param pool - the pool, which ends with a null terminator
+ * @param offset - the offset of the string in the pool
+ * @param field - the field of the string - NAME_FIELD, COUNTRY_FIELD or CITY_FIELD
+ * @return the length of the string if it is valid, 0 otherwise
+ */
+int getValidPooledFieldLen(const StringPool* pool, uint32_t offset, int field)
+{
+    int len = getPooledFieldLen(pool, offset);
+    const char* str = pool->data + offset;
+    int isCity = (field == CITY_FIELD);
+    int numOfChecked = isCity ? len - 1 : len;
+    for (int i = 0; i < numOfChecked; i++)
+    {
+        if (!isPlaceCharacter(str[i], field == NAME_FIELD))
+        {
+            return 0;
+        }
+    }
+    if (isCity && len > 0 && (str[len - 1] == FIELDS_DELIMITER || str[len - 1] == END_OF_LINE))
+    {
+        return 0;
+    }
+    return len;
+}
+
+
+/**
+ * This function checks that the columns of a snapshot are safe to use, beyond the snapshot being consistent with
+ * itself - every student passes the checks validateRow applies to a row (so every string is a field that fits a
+ * field buffer), every name prefix matches its name, the pool ends with a null terminator, and every student in
+ * the orders is in the store
+ * @param store - the store of students, whose columns point at the sections of the snapshot
+ * @param hasOrders - 1 if the snapshot contains the orders of the students, 0 otherwise
+ * @return 1 if the columns are safe to use, 0 otherwise
+ */
+int areSnapshotColumnsValid(const StudentStore* store, int hasOrders)
+{
+    if (store->numOfStudents == NO_STUDENTS)
+    {
+        return VALID;
+    }
+    if (store->pool.size == 0 || store->pool.data[store->pool.size - 1] != '\0')
+    {
+        return INVALID;
+    }
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        int nameLen = getValidPooledFieldLen(&store->pool, store->nameOffsets[i], NAME_FIELD);
+        if (nameLen == 0 || getValidPooledFieldLen(&store->pool, store->countryOffsets[i], COUNTRY_FIELD) == 0 ||
+            getValidPooledFieldLen(&store->pool, store->cityOffsets[i], CITY_FIELD) == 0 ||
+            store->namePrefixes[i] != namePrefix(store->pool.data + store->nameOffsets[i], nameLen))
+        {
+            return INVALID;
+        }
+        if (store->ids[i] < MIN_ID || store->ids[i] > MAX_ID || store->grades[i] > HIGHEST_GRADE ||
+            store->ages[i] < YOUNGEST_AGE || store->ages[i] > OLDEST_AGE)
+        {
+            return INVALID;
+        }
+        if (hasOrders && (store->gradeOrder[i].index < 0 || store->gradeOrder[i].index >= store->numOfStudents ||
+                          store->nameOrder[i].index < 0 || store->nameOrder[i].index >= store->numOfStudents))
+        {
+            return INVALID;
+        }
+    }
+    return VALID;
+}
+
+
+/**
+ * This function writes a section of the snapshot, padded with zeros to the alignment of the snapshot
+ * @param file - the snapshot file
+ * @param data - the section
+ * @param size - the number of bytes in the section
+ * @param pChecksum - pointer to the checksum of the sections so far
+ * @return 1 if the section was written, 0 otherwise
+ */
+int writeSnapshotSection(FILE* file, const void* data, size_t size, uint64_t* pChecksum)
+{
+    static const char padding[SNAPSHOT_ALIGNMENT] = {0};
+    size_t paddingSize = alignSection(size) - size;
+    *pChecksum = updateChecksum(*pChecksum, data, size);
+    return fwrite(data, 1, size, file) == size && fwrite(padding, 1, paddingSize, file) == paddingSize;
+}
+
+
+/**
+ * This function saves the store of students to a snapshot file, which can be loaded instead of reading and
+ * validating the input again. The orders of the students by grade and by name are saved with them. The snapshot is
+ * written to a temporary file which then replaces the old one, since the store may be mapped from that very file
+ * @param store - the store of students, with both orders
+ * @param snapshotPath - the path of the snapshot file
+ */
+void saveSnapshot(const StudentStore* store, const char snapshotPath[])
+{
+    char* tempPath = (char*)malloc(strlen(snapshotPath) + sizeof(SNAPSHOT_TEMP_SUFFIX));
+    if (tempPath == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    strcpy(tempPath, snapshotPath);
+    strcat(tempPath, SNAPSHOT_TEMP_SUFFIX);
+    FILE* file = fopen(tempPath, WRITE_BINARY);
+    if (file == NULL)
+    {
+        free(tempPath);
+        printf(ERROR_SAVE_SNAPSHOT);
+        exit(UNSUCCESSFUL);
+    }
+
+    size_t n = (size_t)store->numOfStudents;
+    SnapshotHeader header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, (uint32_t)n, store->pool.size, SNAPSHOT_HAS_ORDERS,
+                             CHECKSUM_BASIS};
+    int isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                    writeSnapshotSection(file, store->ids, n * sizeof(uint64_t), &header.checksum) &&
+                    writeSnapshotSection(file, store->namePrefixes, n * sizeof(uint64_t), &header.checksum) &&
+                    writeSnapshotSection(file, store->nameOffsets, n * sizeof(uint32_t), &header.checksum) &&
+                    writeSnapshotSection(file, store->countryOffsets, n * sizeof(uint32_t), &header.checksum) &&
+                    writeSnapshotSection(file, store->cityOffsets, n * sizeof(uint32_t), &header.checksum) &&
+                    writeSnapshotSection(file, store->grades, n, &header.checksum) &&
+                    writeSnapshotSection(file, store->ages, n, &header.checksum) &&
+                    writeSnapshotSection(file, store->pool.data, store->pool.size, &header.checksum) &&
+                    writeSnapshotSection(file, store->gradeOrder, n * sizeof(SortEntry), &header.checksum) &&
+                    writeSnapshotSection(file, store->nameOrder, n * sizeof(SortEntry), &header.checksum);
+
+    // now that the checksum is known, write the header again, and make sure it is on disk before the rename
+    isWritten = isWritten && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1 &&
+                fflush(file) == 0 && fsync(fileno(file)) == 0;
+    isWritten = fclose(file) == 0 && isWritten && rename(tempPath, snapshotPath) == 0;
+    if (!isWritten)
+    {
+        remove(tempPath);
+        free(tempPath);
+        printf(ERROR_SAVE_SNAPSHOT);
+        exit(UNSUCCESSFUL);
+    }
+    free(tempPath);
+}
+
+
+/**
+ * This function loads a store of students from a snapshot file. The file is mapped to memory, and the columns of
+ * the store point directly into it (pages are copied only if they are changed)
+ * @param store - the store of students to initialize
+ * @param snapshotPath - the path of the snapshot file
+ */
+void loadSnapshot(StudentStore* store, const char snapshotPath[])
+{
+    memset(store, 0, sizeof(StudentStore));
+    int fd = open(snapshotPath, O_RDONLY);
+    struct stat fileInfo;
+    if (fd < 0 || fstat(fd, &fileInfo) != 0 || (size_t)fileInfo.st_size < sizeof(SnapshotHeader))
+    {
+        printf(ERROR_LOAD_SNAPSHOT);
+        exit(UNSUCCESSFUL);
+    }
+
+    size_t mappingSize = (size_t)fileInfo.st_size;
+    void* mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid after closing
+    if (mapping == MAP_FAILED)
+    {
+        printf(ERROR_LOAD_SNAPSHOT);
+        exit(UNSUCCESSFUL);
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, mapping, sizeof(header));
+    char* payload = (char*)mapping + sizeof(header);
+    store->numOfStudents = (int)header.numOfStudents;
+    store->capacity = store->numOfStudents;
+    store->pool.size = header.poolSize;
+    store->pool.capacity = header.poolSize;
+    int hasOrders = (header.flags & SNAPSHOT_HAS_ORDERS) != 0;
+    if (header.magic != SNAPSHOT_MAGIC || header.version < FIRST_SNAPSHOT_VERSION ||
+        header.version > SNAPSHOT_VERSION || (header.version == FIRST_SNAPSHOT_VERSION && header.flags != 0) ||
+        header.numOfStudents > INT32_MAX ||
+        placeSnapshotSections(store, payload, hasOrders) != mappingSize - sizeof(header) ||
+        updateChecksum(CHECKSUM_BASIS, payload, mappingSize - sizeof(header)) != header.checksum ||
+        !areSnapshotColumnsValid(store, hasOrders))
+    {
+        munmap(mapping, mappingSize);
+        printf(ERROR_LOAD_SNAPSHOT);
+        exit(UNSUCCESSFUL);
+    }
+    store->mapping = mapping;
+    store->mappingSize = mappingSize;
+    store->areOrdersMapped = hasOrders;
+}
+
+
+/**
+ * This function returns the students sorted by grade, and sorts them only if they weren't sorted before
+ * @param store - the store of students
+ * @param numOfThreads - the number of threads to sort with
+ * @return the students sorted by grade (owned by the store)
+ */
+const SortEntry* getGradeOrder(StudentStore* store, int numOfThreads)
+{
+    if (store->gradeOrder == NULL)
+    {
+        store->gradeOrder = sortByGrade(store, numOfThreads);
+    }
+    return store->gradeOrder;
+}
+
+
+/**
+ * This function returns the students sorted by name, and sorts them only if they weren't sorted before
+ * @param store - the store of students
+ * @return the students sorted by name (owned by the store)
+ */
+const SortEntry* getNameOrder(StudentStore* store)
+{
+    if (store->nameOrder == NULL)
+    {
+        store->nameOrder = sortByName(store);
+    }
+    return store->nameOrder;
+}
+
+
+/**
+ * This function copies an array from a mapped snapshot to the heap
+ * @param data - the array
+ * @param size - the number of bytes in the array
+ * @param capacity - the number of bytes to allocate, at least size
+ * @return the copy (the caller is responsible for freeing)
+ */
+void* copyToHeap(const void* data, size_t size, size_t capacity)
+{
+    void* copy = malloc(capacity > 0 ? capacity : 1);
+    if (copy == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    if (data != NULL)
+    {
+        memcpy(copy, data, size);
+    }
+    return copy;
+}
+
+
+/**
+ * This function moves a store which was loaded from a snapshot to the heap, so that it can be changed. The table of
+ * interned places is rebuilt from the countries and cities of the students
+ * @param store - the store of students
+ */
+void detachStore(StudentStore* store)
+{
+    if (store->mapping == NULL)
+    {
+        return;
+    }
+
+    StudentStore copy;
+    initStudentStore(&copy, store->numOfStudents);
+    size_t n = (size_t)store->numOfStudents;
+    memcpy(copy.ids, store->ids, n * sizeof(uint64_t));
+    memcpy(copy.grades, store->grades, n);
+    memcpy(copy.ages, store->ages, n);
+    memcpy(copy.nameOffsets, store->nameOffsets, n * sizeof(uint32_t));
+    memcpy(copy.namePrefixes, store->namePrefixes, n * sizeof(uint64_t));
+    memcpy(copy.countryOffsets, store->countryOffsets, n * sizeof(uint32_t));
+    memcpy(copy.cityOffsets, store->cityOffsets, n * sizeof(uint32_t));
+    copy.numOfStudents = store->numOfStudents;
+    free(copy.pool.data);
+    copy.pool.capacity = store->pool.size > INITIAL_POOL_CAPACITY ? store->pool.size : INITIAL_POOL_CAPACITY;
+    copy.pool.data = (char*)copyToHeap(store->pool.data, store->pool.size, copy.pool.capacity);
+    copy.pool.size = store->pool.size;
+    if (store->gradeOrder != NULL)
+    {
+        copy.gradeOrder = (SortEntry*)copyToHeap(store->gradeOrder, n * sizeof(SortEntry), n * sizeof(SortEntry));
+        copy.nameOrder = (SortEntry*)copyToHeap(store->nameOrder, n * sizeof(SortEntry), n * sizeof(SortEntry));
+    }
+
+    for (int i = 0; i < copy.numOfStudents; i++)
+    {
+        internPooledString(&copy, copy.countryOffsets[i]);
+        internPooledString(&copy, copy.cityOffsets[i]);
+    }
+
+    freeStudentStore(store);
+    *store = copy;
+}
+
+
+/**
+ * This function compares two ids, for sorting them with qsort
+ * @param first - pointer to the first id
+ * @param second - pointer to the second id
+ * @return negative, zero or positive if the first id is smaller, equal or bigger than the second
+ */
+int compareIds(const void* first, const void* second)
+{
+    uint64_t firstId = *(const uint64_t*)first;
+    uint64_t secondId = *(const uint64_t*)second;
+    return (firstId > secondId) - (firstId < secondId);
+}
+
+
+/**
+ * This function compares two name entries by their prefixes, for sorting them with qsort
+ * @param first - pointer to the first name entry
+ * @param second - pointer to the second name entry
+ * @return negative, zero or positive if the prefix of the first entry is smaller, equal or bigger than the second
+ */
+int compareNameEntryPrefixes(const void* first, const void* second)
+{
+    uint64_t firstPrefix = ((const NameEntry*)first)->prefix;
+    uint64_t secondPrefix = ((const NameEntry*)second)->prefix;
+    return (firstPrefix > secondPrefix) - (firstPrefix < secondPrefix);
+}
+
+
+/**
+ * This function reads the ids of the students to delete, one per line. Invalid ids are reported like invalid
+ * student rows
+ * @param deletePath - the path of the file of ids
+ * @param pNumOfIds - pointer to the number of ids which were read
+ * @return the ids, sorted (the caller is responsible for freeing)
+ */
+uint64_t* readDeletedIds(const char deletePath[], int* pNumOfIds)
+{
+    FILE* file = openInputFile(deletePath);
+    int capacity = INITIAL_CAPACITY;
+    uint64_t* ids = (uint64_t*)copyToHeap(NULL, 0, capacity * sizeof(uint64_t));
+    char line[MAX_ROW_LEN];
+    *pNumOfIds = 0;
+
+    for (int lineNum = 0; fgets(line, MAX_ROW_LEN, file) != NULL; lineNum++)
+    {
+        int len = (int)strcspn(line, "\r\n");
+        uint64_t id = 0;
+        int isValid = (len == ID_LEN && line[0] != '0');
+        for (int i = 0; i < len && isValid; i++)
+        {
+            isValid = (line[i] >= '0' && line[i] <= '9');
+            id = id * BASE + (line[i] - '0');
+        }
+        if (!isValid)
+        {
+            printf(ERROR_ID_MSG);
+            printf(IN_LINE_N_MSG, lineNum);
+            continue;
+        }
+
+        if (*pNumOfIds == capacity)
+        {
+            capacity *= GROWTH_FACTOR;
+            ids = (uint64_t*)resizeColumn(ids, sizeof(uint64_t), capacity);
+        }
+        ids[(*pNumOfIds)++] = id;
+    }
+    fclose(file); // only read from the file, no need to check if fclose worked
+
+    qsort(ids, *pNumOfIds, sizeof(uint64_t), compareIds);
+    return ids;
+}
+
+
+/**
+ * This function removes the students with the given ids from the store, keeping the order of the others
+ * @param store - the store of students (on the heap)
+ * @param ids - the sorted ids of the students to remove
+ * @param numOfIds - the number of ids
+ * @return for every old index of a student its new index, or -1 if it was removed (the caller is responsible for
+ * freeing)
+ */
+int* removeStudents(StudentStore* store, const uint64_t ids[], int numOfIds)
+{
+    int* newIndices = (int*)copyToHeap(NULL, 0, store->numOfStudents * sizeof(int));
+    int kept = 0;
+    for (int i = 0; i < store->numOfStudents; i++)
+    {
+        if (numOfIds > 0 && bsearch(&store->ids[i], ids, numOfIds, sizeof(uint64_t), compareIds) != NULL)
+        {
+            newIndices[i] = NOT_FOUND;
+            continue;
+        }
+        newIndices[i] = kept;
+        store->ids[kept] = store->ids[i];
+        store->grades[kept] = store->grades[i];
+        store->ages[kept] = store->ages[i];
+        store->nameOffsets[kept] = store->nameOffsets[i];
+        store->namePrefixes[kept] = store->namePrefixes[i];
+        store->countryOffsets[kept] = store->countryOffsets[i];
+        store->cityOffsets[kept] = store->cityOffsets[i];
+        kept++;
+    }
+    store->numOfStudents = kept;
+    return newIndices;
+}
+
+
+/**
+ * This function updates an order after students were removed and added. The removed students are dropped and
+ * the other ones get their new indices, then the sorted added students are merged in. Added students come after
+ * kept students with equal keys, as if the whole store was sorted again
+ * @param order - the old order of the students (freed by this function)
+ * @param oldNumOfStudents - the number of students in the old order
+ * @param newIndices - for every old index of a student its new index, or -1 if it was removed
+ * @param delta - the added students, sorted
+ * @param numOfAdded - the number of added students
+ * @param isHigher - checks if the first student should come after the second one
+ * @param store - the store of students
+ * @return the new order of the students
+ */
+SortEntry* mergeDelta(SortEntry order[], int oldNumOfStudents, const int newIndices[], const SortEntry delta[],
+                      int numOfAdded, int (*isHigher)(const SortEntry*, const SortEntry*, const StudentStore*),
+                      const StudentStore* store)
+{
+    int numOfKept = 0;
+    for (int i = 0; i < oldNumOfStudents; i++) // drop the removed students, and re-index the kept ones
+    {
+        if (newIndices[order[i].index] != NOT_FOUND)
+        {
+            order[numOfKept].key = order[i].key;
+            order[numOfKept].index = newIndices[order[i].index];
+            numOfKept++;
+        }
+    }
+
+    SortEntry* merged = allocateSortEntries(numOfKept + numOfAdded);
+    int i = 0, j = 0, k = 0;
+    while (i < numOfKept && j < numOfAdded)
+    {
+        if (!isHigher(&order[i], &delta[j], store))
+        {
+            merged[k++] = order[i++];
+        }
+        else
+        {
+            merged[k++] = delta[j++];
+        }
+    }
+    while (i < numOfKept)
+    {
+        merged[k++] = order[i++];
+    }
+    while (j < numOfAdded)
+    {
+        merged[k++] = delta[j++];
+    }
+    free(order);
+    return merged;
+}
+
+
+/**
+ * @param first - first sort entry, whose key is a grade
+ * @param second - second sort entry, whose key is a grade
+ * @param store - the store of students (unused)
+ * @return 1 if the first grade is higher, 0 otherwise
+ */
+int isGradeHigher(const SortEntry* first, const SortEntry* second, const StudentStore* store)
+{
+    (void)store;
+    return first->key > second->key;
+}
+
+
+/**
+ * @param first - first sort entry
+ * @param second - second sort entry
+ * @param store - the store of students
+ * @return 1 if the name of the first student is "higher", 0 otherwise
+ */
+int isStoredNameHigher(const SortEntry* first, const SortEntry* second, const StudentStore* store)
+{
+    NameEntry firstName = {store->namePrefixes[first->index], store->nameOffsets[first->index], first->index};
+    NameEntry secondName = {store->namePrefixes[second->index], store->nameOffsets[second->index], second->index};
+    return isNameHigher(&firstName, &secondName, store->pool.data);
+}
+
+
+/**
+ * This function applies changes to a store which was loaded from a snapshot - removes the students with the ids in
+ * the delete file, and adds the students in the append file. The sorted orders are updated by merging the sorted
+ * added students into them, in O(n + d log d) instead of sorting everything again
+ * @param options - the options of the program
+ * @param store - the store of students
+ */
+void applyDelta(const Options* options, StudentStore* store)
+{
+    getGradeOrder(store, options->numOfThreads); // snapshots of the first version have no orders yet
+    getNameOrder(store);
+    detachStore(store);
+
+    int oldNumOfStudents = store->numOfStudents;
+    int numOfIds = 0;
+    uint64_t* ids = options->deletePath != NULL ? readDeletedIds(options->deletePath, &numOfIds) : NULL;
+    int* newIndices = removeStudents(store, ids, numOfIds);
+    free(ids);
+
+    int firstAdded = store->numOfStudents;
+    if (options->appendPath != NULL)
+    {
+        store->duplicateMode = options->duplicateMode;
+        if (options->duplicateMode != KEEP_DUPLICATES)
+        {
+            indexStudentIds(store);
+        }
+        readRowsFromFile(options->appendPath, storeStudent, store);
+    }
+    if (store->idIndex.slots != NULL && store->idIndex.lowestReplaced < firstAdded) // kept students were changed
+    {
+        free(store->gradeOrder);
+        free(store->nameOrder);
+        store->gradeOrder = NULL;
+        store->nameOrder = NULL;
+        free(newIndices);
+        return; // the orders are sorted again when they are needed
+    }
+
+    // sort the added students alone - a store of only them shares the columns with offset indices
+    StudentStore added = *store;
+    int numOfAdded = store->numOfStudents - firstAdded;
+    added.ids += firstAdded;
+    added.grades += firstAdded;
+    added.ages += firstAdded;
+    added.nameOffsets += firstAdded;
+    added.namePrefixes += firstAdded;
+    added.countryOffsets += firstAdded;
+    added.cityOffsets += firstAdded;
+    added.numOfStudents = numOfAdded;
+    SortEntry* gradeDelta = sortByGrade(&added, options->numOfThreads);
+    SortEntry* nameDelta = sortByName(&added);
+    for (int i = 0; i < numOfAdded; i++)
+    {
+        gradeDelta[i].index += firstAdded;
+        nameDelta[i].index += firstAdded;
+    }
+
+    store->gradeOrder = mergeDelta(store->gradeOrder, oldNumOfStudents, newIndices, gradeDelta, numOfAdded,
+                                   isGradeHigher, store);
+    store->nameOrder = mergeDelta(store->nameOrder, oldNumOfStudents, newIndices, nameDelta, numOfAdded,
+                                  isStoredNameHigher, store);
+    free(gradeDelta);
+    free(nameDelta);
+    free(newIndices);
+}
+
+
+/**
+ * This function finds a field by its name
+ * @param name - the name of the field (not necessarily null terminated)
+ * @param len - the number of characters in the name
+ * @return the index of the field, or -1 if there is no such field
+ */
+int findField(const char name[], int len)
+{
+    static const char* const fieldNames[NUM_OF_FIELDS] = {"id", "name", "grade", "age", "country", "city"};
+    for (int field = 0; field < NUM_OF_FIELDS; field++)
+    {
+        if ((int)strlen(fieldNames[field]) == len && !strncmp(fieldNames[field], name, len))
+        {
+            return field;
+        }
+    }
+    return NOT_FOUND;
+}
+
+
+/**
+ * This function compiles the keys of a query, such as "country,city,-grade,name". A '-' before a field sorts it
+ * in descending order
+ * @param spec - the keys, separated by commas
+ * @param query - the query to add the keys to
+ * @return 1 if the keys are valid, 0 otherwise
+ */
+int compileSortKeys(const char spec[], Query* query)
+{
+    query->numOfKeys = 0;
+    while (TRUE)
+    {
+        if (query->numOfKeys == MAX_QUERY_TERMS)
+        {
+            return INVALID;
+        }
+        SortKey* key = &query->keys[query->numOfKeys++];
+        key->isDescending = (*spec == DESCENDING_MARK);
+        spec += key->isDescending;
+        int len = (int)strcspn(spec, ",");
+        key->field = findField(spec, len);
+        if (key->field == NOT_FOUND)
+        {
+            return INVALID;
+        }
+        if (spec[len] != KEYS_DELIMITER)
+        {
+            return VALID;
+        }
+        spec += len + 1;
+    }
+}
+
+
+/**
+ * @param first - first number
+ * @param second - second number
+ * @return LESS, EQUAL or GREATER according to the first number compared to the second one
+ */
+int compareNumbers(uint64_t first, uint64_t second)
+{
+    return first < second ? LESS : first == second ? EQUAL : GREATER;
+}
+
+
+/**
+ * @param first - first string
+ * @param second - second string
+ * @return LESS, EQUAL or GREATER according to the first string compared to the second one
+ */
+int compareStrings(const char first[], const char second[])
+{
+    int result = strcmp(first, second);
+    return result < 0 ? LESS : result == 0 ? EQUAL : GREATER;
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the id of the student compared to the value of the filter
+ */
+int compareId(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareNumbers(store->ids[i], filter->number);
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the grade of the student compared to the value of the filter
+ */
+int compareGrade(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareNumbers(store->grades[i], filter->number);
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the age of the student compared to the value of the filter
+ */
+int compareAge(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareNumbers(store->ages[i], filter->number);
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the name of the student compared to the value of the filter
+ */
+int compareName(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareStrings(getName(store, i), filter->str);
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the country of the student compared to the value of the filter
+ */
+int compareCountry(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareStrings(store->pool.data + store->countryOffsets[i], filter->str);
+}
+
+
+/**
+ * @return LESS, EQUAL or GREATER according to the city of the student compared to the value of the filter
+ */
+int compareCity(const Filter* filter, const StudentStore* store, int i)
+{
+    return compareStrings(store->pool.data + store->cityOffsets[i], filter->str);
+}
+
+
+/**
+ * Places are interned, so checking if they are equal to the value of the filter only compares offsets
+ * @return EQUAL if the country of the student is the value of the filter, GREATER otherwise
+ */
+int compareCountryOffset(const Filter* filter, const StudentStore* store, int i)
+{
+    return store->countryOffsets[i] == filter->place ? EQUAL : GREATER;
+}
+
+
+/**
+ * Places are interned, so checking if they are equal to the value of the filter only compares offsets
+ * @return EQUAL if the city of the student is the value of the filter, GREATER otherwise
+ */
+int compareCityOffset(const Filter* filter, const StudentStore* store, int i)
+{
+    return store->cityOffsets[i] == filter->place ? EQUAL : GREATER;
+}
+
+
+/**
+ * This function compiles a filter of a query, such as "age>=21" or "country=Israel". The operators are =, !=, <,
+ * <=, > and >=, and the values of numeric fields must be numbers
+ * @param spec - the filter
+ * @param filter - the compiled filter
+ * @return 1 if the filter is valid, 0 otherwise
+ */
+int compileFilter(const char spec[], Filter* filter)
+{
+    int fieldLen = (int)strcspn(spec, "=!<>");
+    filter->field = findField(spec, fieldLen);
+    const char* op = spec + fieldLen;
+    if (filter->field == NOT_FOUND)
+    {
+        return INVALID;
+    }
+
+    if (*op == '\0') // no operator
+    {
+        return INVALID;
+    }
+    int opLen = op[0] != '=' && op[1] == '=' ? 2 : 1;
+    if (op[0] == '=')
+    {
+        filter->acceptedResults = EQUAL;
+    }
+    else if (op[0] == '!' && op[1] == '=')
+    {
+        filter->acceptedResults = LESS | GREATER;
+    }
+    else if (op[0] == '<')
+    {
+        filter->acceptedResults = LESS | (opLen == 2 ? EQUAL : 0);
+    }
+    else if (op[0] == '>')
+    {
+        filter->acceptedResults = GREATER | (opLen == 2 ? EQUAL : 0);
+    }
+    else // '!' without '='
+    {
+        return INVALID;
+    }
+
+    static int (*const compareFuncs[NUM_OF_FIELDS])(const Filter*, const StudentStore*, int) =
+        {compareId, compareName, compareGrade, compareAge, compareCountry, compareCity};
+    filter->compare = compareFuncs[filter->field];
+    filter->str = op + opLen;
+    filter->number = 0;
+    filter->place = (uint32_t)NOT_FOUND;
+    if (filter->field == ID_FIELD || filter->field == GRADE_FIELD || filter->field == AGE_FIELD)
+    {
+        char* end = NULL;
+        errno = 0;
+        filter->number = strtoull(filter->str, &end, BASE);
+        return *filter->str >= '0' && *filter->str <= '9' && *end == '\0' && errno == 0;
+    }
+    return VALID;
+}
+
+
+/**
+ * This function binds the filters of a query to the store. Equality filters on places are checked by the offset of
+ * the place in the pool, which is found once here
+ * @param query - the query
+ * @param store - the store of students
+ */
+void bindFilters(Query* query, StudentStore* store)
+{
+    for (int i = 0; i < query->numOfFilters; i++)
+    {
+        Filter* filter = &query->filters[i];
+        int isPlace = (filter->field == COUNTRY_FIELD || filter->field == CITY_FIELD);
+        if (!isPlace || (filter->acceptedResults != EQUAL && filter->acceptedResults != (LESS | GREATER)))
+        {
+            continue;
+        }
+
+        filter->compare = filter->field == COUNTRY_FIELD ? compareCountryOffset : compareCityOffset;
+        InternTable* places = &store->places;
+        if (places->slots == NULL) // a store loaded from a snapshot has no table of interned places
+        {
+            detachStore(store);
+        }
+        int len = (int)strlen(filter->str);
+        uint32_t slot = hashString(filter->str, len) & (places->capacity - 1);
+        for (; places->slots[slot] != EMPTY_SLOT; slot = (slot + 1) & (places->capacity - 1)) // linear probing
+        {
+            if (!strcmp(store->pool.data + places->slots[slot] - 1, filter->str))
+            {
+                filter->place = places->slots[slot] - 1;
+                break;
+            }
+        }
+    }
+}
+
+
+/**
+ * This function ranks the selected students by a field - students with equal values get equal ranks, and a
+ * student with a bigger value gets a bigger rank
+ * @param store - the store of students
+ * @param selected - the indices of the selected students
+ * @param numOfSelected - the number of selected students
+ * @param field - the field to rank by
+ * @param ranks - output ranks, indexed by the index of the student in the store
+ * @return the number of different ranks
+ */
+uint32_t rankByField(const StudentStore* store, const int selected[], int numOfSelected, int field, uint32_t ranks[])
+{
+    if (field == GRADE_FIELD || field == AGE_FIELD) // small numbers are their own ranks
+    {
+        const unsigned char* values = field == GRADE_FIELD ? store->grades : store->ages;
+        for (int i = 0; i < numOfSelected; i++)
+        {
+            ranks[selected[i]] = values[selected[i]];
+        }
+        return field == GRADE_FIELD ? HIGHEST_GRADE + 1 : OLDEST_AGE + 1;
+    }
+
+    // other fields are sorted, ids by the prefix of a name entry and strings like names
+    NameEntry* entries = (NameEntry*)malloc((numOfSelected + 1) * sizeof(NameEntry));
+    if (entries == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    const uint32_t* offsets = field == NAME_FIELD ? store->nameOffsets :
+                              field == COUNTRY_FIELD ? store->countryOffsets : store->cityOffsets;
+    for (int i = 0; i < numOfSelected; i++)
+    {
+        int student = selected[i];
+        entries[i].index = student;
+        if (field == ID_FIELD)
+        {
+            entries[i].prefix = store->ids[student];
+            entries[i].offset = 0;
+            continue;
+        }
+        const char* str = store->pool.data + offsets[student];
+        entries[i].offset = offsets[student];
+        entries[i].prefix = field == NAME_FIELD ? store->namePrefixes[student] : namePrefix(str, (int)strlen(str));
+    }
+
+    if (field == ID_FIELD)
+    {
+        qsort(entries, numOfSelected, sizeof(NameEntry), compareNameEntryPrefixes);
+    }
+    else
+    {
+        int depthLimit = 0;
+        for (int size = numOfSelected; size > 1; size /= 2)
+        {
+            depthLimit += DEPTH_LIMIT_FACTOR;
+        }
+        quickSort(entries, 0, numOfSelected - 1, depthLimit, store->pool.data);
+    }
+
+    uint32_t rank = 0;
+    for (int i = 0; i < numOfSelected; i++)
+    {
+        if (i > 0 && (field == ID_FIELD ? entries[i].prefix != entries[i - 1].prefix :
+                      isNameHigher(&entries[i], &entries[i - 1], store->pool.data)))
+        {
+            rank++;
+        }
+        ranks[entries[i].index] = rank;
+    }
+    free(entries);
+    return rank + 1;
+}
+
+
+/**
+ * This function runs a query - filters the students by each filter in turn, keeping only the students which pass
+ * all of them, and then sorts them by the keys. Every key is turned into ranks, and the students are counting
+ * sorted by the ranks from the last key to the first one. Each pass keeps the order of equal students, so ties
+ * are broken by the following keys, and then by the order of the input
+ * @param query - the query
+ * @param store - the store of students
+ * @param pNumOfSelected - pointer to the number of students which pass the filters
+ * @return the selected students in order (the caller is responsible for freeing)
+ */
+SortEntry* runQuery(Query* query, StudentStore* store, int* pNumOfSelected)
+{
+    bindFilters(query, store);
+    int* selected = (int*)copyToHeap(NULL, 0, store->numOfStudents * sizeof(int));
+    int numOfSelected = store->numOfStudents;
+    for (int i = 0; i < numOfSelected; i++)
+    {
+        selected[i] = i;
+    }
+
+    for (int f = 0; f < query->numOfFilters; f++) // every filter narrows the selected students
+    {
+        const Filter* filter = &query->filters[f];
+        int numOfPassed = 0;
+        for (int i = 0; i < numOfSelected; i++)
+        {
+            selected[numOfPassed] = selected[i];
+            numOfPassed += (filter->compare(filter, store, selected[i]) & filter->acceptedResults) != 0;
+        }
+        numOfSelected = numOfPassed;
+    }
+
+    uint32_t* ranks = (uint32_t*)copyToHeap(NULL, 0, store->numOfStudents * sizeof(uint32_t));
+    int* sorted = (int*)copyToHeap(NULL, 0, numOfSelected * sizeof(int));
+    for (int k = query->numOfKeys - 1; k >= 0; k--)
+    {
+        const SortKey* key = &query->keys[k];
+        uint32_t numOfRanks = rankByField(store, selected, numOfSelected, key->field, ranks);
+        int* positions = (int*)calloc(numOfRanks + 1, sizeof(int));
+        if (positions == NULL)
+        {
+            exitOnAllocationFailure();
+        }
+        for (int i = 0; i < numOfSelected; i++) // count the students of each rank
+        {
+            uint32_t rank = ranks[selected[i]];
+            positions[(key->isDescending ? numOfRanks - 1 - rank : rank) + 1]++;
+        }
+        for (uint32_t rank = 0; rank < numOfRanks; rank++) // turn the counts into the first position of each rank
+        {
+            positions[rank + 1] += positions[rank];
+        }
+        for (int i = 0; i < numOfSelected; i++) // scatter the students in their current order
+        {
+            uint32_t rank = ranks[selected[i]];
+            sorted[positions[key->isDescending ? numOfRanks - 1 - rank : rank]++] = selected[i];
+        }
+        free(positions);
+        int* temp = selected;
+        selected = sorted;
+        sorted = temp;
+    }
+
+    SortEntry* order = allocateSortEntries(numOfSelected);
+    for (int i = 0; i < numOfSelected; i++)
+    {
+        order[i].key = query->numOfKeys > 0 ? ranks[selected[i]] : 0;
+        order[i].index = selected[i];
+    }
+    free(ranks);
+    free(sorted);
+    free(selected);
+    *pNumOfSelected = numOfSelected;
+    return order;
+}
+
+
+/**
+ * This function builds the store of students - either from a snapshot (with the changes given in the options), or
+ * by reading the input. The store is saved to a snapshot if this was asked for
+ * @param options - the options of the program
+ * @param store - the store of students to initialize
+ */
+void buildStore(const Options* options, StudentStore* store)
+{
+    if (options->loadSnapshotPath != NULL)
+    {
+        loadSnapshot(store, options->loadSnapshotPath);
+        if (options->appendPath != NULL || options->deletePath != NULL)
+        {
+            applyDelta(options, store);
+        }
+    }
+    else
+    {
+        readStudents(options->inputPath, store, options->numOfThreads, options->duplicateMode);
+    }
+
+    if (options->saveSnapshotPath != NULL)
+    {
+        getGradeOrder(store, options->numOfThreads);
+        getNameOrder(store);
+        saveSnapshot(store, options->saveSnapshotPath);
+    }
+}
+
+
+/**
+ * This function returns the next number of a xorshift* pseudo random sequence, so that generated rosters are the
+ * same for the same seed on every machine
+ * @param state - the state of the sequence, not zero
+ * @return the next number
+ */
+uint64_t nextRandom(uint64_t* state)
+{
+    *state ^= *state >> XORSHIFT_A;
+    *state ^= *state << XORSHIFT_B;
+    *state ^= *state >> XORSHIFT_C;
+    return *state * XORSHIFT_MULTIPLIER;
+}
+
+
+/**
+ * This function writes a name which encodes a number in base 26, so that names of bigger numbers come later in
+ * alphabetic order
+ * @param output - the output buffer, with room for the name
+ * @param number - the number
+ */
+void appendGeneratedName(OutputBuffer* output, uint64_t number)
+{
+    char name[GENERATED_NAME_LEN];
+    for (int i = GENERATED_NAME_LEN - 1; i >= 0; i--)
+    {
+        name[i] = (char)((i == 0 ? 'A' : 'a') + number % NUM_OF_LETTERS);
+        number /= NUM_OF_LETTERS;
+    }
+    memcpy(output->data + output->len, name, GENERATED_NAME_LEN);
+    output->len += GENERATED_NAME_LEN;
+}
+
+
+/**
+ * This function prints a synthetic roster of valid students. The names and grades follow the row numbers in the
+ * sorted and reversed distributions, are random in the random one, and take only a few values in the duplicates
+ * one. Ids, ages and places are always random
+ * @param options - the options of the program - the number of rows, the distribution and the seed
+ */
+void generateStudents(const Options* options)
+{
+    static const char* const countries[] = {"Israel", "USA", "UK", "France", "New-Zealand"};
+    static const char* const cities[] = {"Jerusalem", "Tel-Aviv", "Haifa", "London", "Paris", "NYC"};
+    OutputBuffer output;
+    output.data = (char*)malloc(OUTPUT_BUFFER_SIZE);
+    output.len = 0;
+    if (output.data == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+    uint64_t state = options->seed != 0 ? options->seed : DEFAULT_SEED;
+
+    for (long i = 0; i < options->numOfRows; i++)
+    {
+        if (output.len > OUTPUT_BUFFER_SIZE - MAX_OUTPUT_ROW_LEN) // make sure the next row fits
+        {
+            flushOutput(&output);
+        }
+        long position = options->distribution == REVERSED_DISTRIBUTION ? options->numOfRows - 1 - i : i;
+        uint64_t nameNumber = (uint64_t)position;
+        int grade = (int)(position * NUM_OF_GRADES / options->numOfRows);
+        if (options->distribution == RANDOM_DISTRIBUTION)
+        {
+            nameNumber = nextRandom(&state);
+            grade = (int)(nextRandom(&state) % NUM_OF_GRADES);
+        }
+        else if (options->distribution == DUPLICATES_DISTRIBUTION)
+        {
+            nameNumber = nextRandom(&state) % NUM_OF_DUPLICATE_VALUES;
+            grade = (int)(nextRandom(&state) % NUM_OF_DUPLICATE_VALUES) * (HIGHEST_GRADE / NUM_OF_DUPLICATE_VALUES);
+        }
+
+        appendNumber(&output, MIN_ID + nextRandom(&state) % (MAX_ID - MIN_ID + 1));
+        appendChar(&output, FIELDS_DELIMITER);
+        appendGeneratedName(&output, nameNumber);
+        appendChar(&output, FIELDS_DELIMITER);
+        appendNumber(&output, LOWEST_GRADE + grade);
+        appendChar(&output, FIELDS_DELIMITER);
+        appendNumber(&output, YOUNGEST_AGE + nextRandom(&state) % (OLDEST_AGE - YOUNGEST_AGE + 1));
+        appendChar(&output, FIELDS_DELIMITER);
+        appendString(&output, countries[nextRandom(&state) % (sizeof(countries) / sizeof(countries[0]))]);
+        appendChar(&output, FIELDS_DELIMITER);
+        appendString(&output, cities[nextRandom(&state) % (sizeof(cities) / sizeof(cities[0]))]);
+        appendChar(&output, END_OF_LINE);
+    }
+
+    flushOutput(&output);
+    free(output.data);
+}
+
+
+/**
+ * @param start - the time a stage started
+ * @return the milliseconds since the stage started
+ */
+double millisecondsSince(const struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * MS_IN_SECOND + (now.tv_nsec - start->tv_nsec) / (double)NS_IN_MS;
+}
+
+
+/**
+ * This function compares two durations, for sorting them with qsort
+ * @param first - pointer to the first duration
+ * @param second - pointer to the second duration
+ * @return negative, zero or positive if the first duration is shorter, equal or longer than the second
+ */
+int compareDurations(const void* first, const void* second)
+{
+    double firstDuration = *(const double*)first;
+    double secondDuration = *(const double*)second;
+    return (firstDuration > secondDuration) - (firstDuration < secondDuration);
+}
+
+
+/**
+ * @param numOfRuns - the number of sorted durations
+ * @param percentile - the percentile, 1 to 100
+ * @return the index of the duration of the percentile, by the nearest rank
+ */
+int percentileIndex(int numOfRuns, int percentile)
+{
+    return (numOfRuns * percentile + PERCENT - 1) / PERCENT - 1;
+}
+
+
+/**
+ * This function reads a whole file into memory
+ * @param inputPath - the path of the file
+ * @param pSize - pointer to the size of the file
+ * @return the content of the file (the caller is responsible for freeing)
+ */
+char* readWholeFile(const char inputPath[], long* pSize)
+{
+    FILE* inputFile = openInputFile(inputPath);
+    fseek(inputFile, 0, SEEK_END);
+    *pSize = ftell(inputFile);
+    rewind(inputFile);
+    char* data = (char*)malloc(*pSize + 1);
+    if (data == NULL)
+    {
+        fclose(inputFile);
+        exitOnAllocationFailure();
+    }
+    *pSize = (long)fread(data, 1, *pSize, inputFile);
+    fclose(inputFile); // only read from the file, no need to check if fclose worked
+    return data;
+}
+
+
+/**
+ * This function measures the stages of the program on an input file - reading into a store (with validation),
+ * validation alone, sorting by grade, sorting by name, finding the best student and printing. Every stage runs the
+ * given number of times, and its median, 90th percentile and slowest run are reported with the rows per second of
+ * the median run. Everything the stages print is discarded
+ * @param options - the options of the program - the input file, the number of runs and the number of threads
+ */
+void runBenchmark(const Options* options)
+{
+    static const char* const stageNames[NUM_OF_STAGES] = {"ingestion", "validation", "gradeSort", "nameSort",
+                                                          "findBestStudent", "printStudents"};
+    double (*durations)[MAX_RUNS] = (double (*)[MAX_RUNS])malloc(NUM_OF_STAGES * sizeof(*durations));
+    long inputSize = 0;
+    char* input = readWholeFile(options->inputPath, &inputSize);
+    if (durations == NULL)
+    {
+        exitOnAllocationFailure();
+    }
+
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    int devNull = open(NULL_DEVICE, O_WRONLY);
+    if (savedStdout < 0 || devNull < 0 || dup2(devNull, STDOUT_FILENO) < 0)
+    {
+        printf(ERROR_OPEN_OUTPUT);
+        exit(UNSUCCESSFUL);
+    }
+    close(devNull);
+
+    int numOfRows = 0;
+    for (int run = 0; run < options->numOfRuns; run++)
+    {
+        struct timespec start;
+        StudentStore store;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        readStudents(options->inputPath, &store, options->numOfThreads, KEEP_DUPLICATES);
+        durations[INGESTION_STAGE][run] = millisecondsSince(&start);
+        numOfRows = store.numOfStudents;
+
+        ReadChunk chunk;
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.start = input;
+        chunk.end = input + inputSize;
+        chunk.studentsCapacity = (int)(inputSize / MIN_BYTES_PER_ROW) + 1;
+        chunk.students = (StudentRow*)resizeColumn(NULL, sizeof(StudentRow), chunk.studentsCapacity);
+        chunk.errorsCapacity = INITIAL_CAPACITY;
+        chunk.errors = (RowError*)resizeColumn(NULL, sizeof(RowError), chunk.errorsCapacity);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        parseChunk(&chunk);
+        durations[VALIDATION_STAGE][run] = millisecondsSince(&start);
+        free(chunk.students);
+        free(chunk.errors);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        SortEntry* gradeOrder = sortByGrade(&store, options->numOfThreads);
+        durations[GRADE_SORT_STAGE][run] = millisecondsSince(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        SortEntry* nameOrder = sortByName(&store);
+        durations[NAME_SORT_STAGE][run] = millisecondsSince(&start);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        volatile int best = store.numOfStudents != NO_STUDENTS ? findBestStudent(&store) : NOT_FOUND;
+        durations[BEST_STAGE][run] = millisecondsSince(&start);
+        (void)best;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        printStudents(&store, gradeOrder, store.numOfStudents);
+        durations[PRINT_STAGE][run] = millisecondsSince(&start);
+
+        free(gradeOrder);
+        free(nameOrder);
+        freeStudentStore(&store);
+    }
+
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    printf(BENCH_HEADER, numOfRows, options->numOfRuns, options->numOfThreads);
+    for (int stage = 0; stage < NUM_OF_STAGES; stage++)
+    {
+        double* times = durations[stage];
+        qsort(times, options->numOfRuns, sizeof(double), compareDurations);
+        double median = times[percentileIndex(options->numOfRuns, MEDIAN_PERCENTILE)];
+        double high = times[percentileIndex(options->numOfRuns, HIGH_PERCENTILE)];
+        double rowsPerSecond = median > 0 ? numOfRows * MS_IN_SECOND / median : 0;
+        printf(BENCH_INFO, stageNames[stage], median, high, times[options->numOfRuns - 1], rowsPerSecond);
+    }
+
+    free(input);
+    free(durations);
+}
+
+
+/**
+ * This function parses the options given after the command. Every option is followed by its value
+ * @param argc - the number of parameters
+ * @param argv - the parameters
+ * @param options - the parsed options
+ * @return 1 if the options are valid, 0 otherwise
+ */
+int parseOptions(int argc, char *argv[], Options* options)
+{
+    options->inputPath = NULL;
+    options->numOfThreads = 1;
+    options->top = 0;
+    options->saveSnapshotPath = NULL;
+    options->loadSnapshotPath = NULL;
+    options->appendPath = NULL;
+    options->deletePath = NULL;
+    options->query.numOfKeys = 0;
+    options->query.numOfFilters = 0;
+    options->groupField = COUNTRY_FIELD;
+    options->duplicateMode = KEEP_DUPLICATES;
+    options->numOfRows = DEFAULT_NUM_OF_ROWS;
+    options->distribution = RANDOM_DISTRIBUTION;
+    options->seed = 0;
+    options->numOfRuns = DEFAULT_NUM_OF_RUNS;
+    options->maxRowsInMemory = 0;
+
+    for (int i = FIRST_OPTION_ARG; i < argc; i += 2)
+    {
+        if (i + 1 == argc) // an option without a value
+        {
+            return INVALID;
+        }
+
+        if (!strcmp(argv[i], INPUT_OPTION))
+        {
+            options->inputPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], SAVE_SNAPSHOT_OPTION))
+        {
+            options->saveSnapshotPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], LOAD_SNAPSHOT_OPTION))
+        {
+            options->loadSnapshotPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], APPEND_OPTION))
+        {
+            options->appendPath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], DELETE_OPTION))
+        {
+            options->deletePath = argv[i + 1];
+        }
+        else if (!strcmp(argv[i], KEYS_OPTION))
+        {
+            if (!compileSortKeys(argv[i + 1], &options->query))
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], FILTER_OPTION))
+        {
+            if (options->query.numOfFilters == MAX_QUERY_TERMS ||
+                !compileFilter(argv[i + 1], &options->query.filters[options->query.numOfFilters++]))
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], BY_OPTION))
+        {
+            options->groupField = findField(argv[i + 1], (int)strlen(argv[i + 1]));
+            if (options->groupField != COUNTRY_FIELD && options->groupField != CITY_FIELD)
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], DUPLICATES_OPTION))
+        {
+            if (!strcmp(argv[i + 1], KEEP_STR))
+            {
+                options->duplicateMode = KEEP_DUPLICATES;
+            }
+            else if (!strcmp(argv[i + 1], REPORT_STR))
+            {
+                options->duplicateMode = REPORT_DUPLICATES;
+            }
+            else if (!strcmp(argv[i + 1], REPLACE_STR))
+            {
+                options->duplicateMode = REPLACE_DUPLICATES;
+            }
+            else
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], DISTRIBUTION_OPTION))
+        {
+            static const char* const distributions[NUM_OF_DISTRIBUTIONS] = {"sorted", "reversed", "random",
+                                                                            "duplicates"};
+            options->distribution = NOT_FOUND;
+            for (int d = 0; d < NUM_OF_DISTRIBUTIONS; d++)
+            {
+                options->distribution = !strcmp(argv[i + 1], distributions[d]) ? d : options->distribution;
+            }
+            if (options->distribution == NOT_FOUND)
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], SEED_OPTION))
+        {
+            char* end = NULL;
+            errno = 0;
+            options->seed = strtoull(argv[i + 1], &end, BASE);
+            if (*end != '\0' || errno != 0)
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], ROWS_OPTION))
+        {
+            char* end = NULL;
+            options->numOfRows = strtol(argv[i + 1], &end, BASE);
+            if (*end != '\0' || options->numOfRows < 1 || options->numOfRows > MAX_NUM_OF_ROWS)
+            {
+                return INVALID;
+            }
+        }
+        else if (!strcmp(argv[i], RUNS_OPTION))
+        {
+            char* end = NULL;
+            long numOfRuns = strtol(argv[i + 1], &end, BASE);
+            if (*end != '\0' || numOfRuns < 1 || numOfRuns > MAX_RUNS)
+            {
+                return INVALID;
+            }
+            options->numOfRuns = (int)numOfRuns;
+        }
+        else if (!strcmp(argv[i], MAX_ROWS_IN_MEMORY_OPTION))
+        {
+            char* end = NULL;
+            long maxRowsInMemory = strtol(argv[i + 1], &end, BASE);
+            if (*end != '\0' || maxRowsInMemory < 1 || maxRowsInMemory > MAX_NUM_OF_ROWS)
+            {
+                return INVALID;
+            }
+            options->maxRowsInMemory = (int)maxRowsInMemory;
+        }
+        else if (!strcmp(argv[i], TOP_OPTION))
+        {
+            char* end = NULL;
+            long top = strtol(argv[i + 1], &end, BASE);
+            if (*end != '\0' || top < 1 || top > MAX_TOP)
+            {
+                return INVALID;
+            }
+            options->top = (int)top;
+        }
+        else if (!strcmp(argv[i], THREADS_OPTION))
+        {
+            char* end = NULL;
+            long numOfThreads = strtol(argv[i + 1], &end, BASE);
+            if (*end != '\0' || numOfThreads < 1 || numOfThreads > MAX_NUM_OF_THREADS)
+            {
+                return INVALID;
+            }
+            options->numOfThreads = (int)numOfThreads;
+        }
+        else // unknown option
+        {
+            return INVALID;
+        }
+    }
+    if ((options->appendPath != NULL || options->deletePath != NULL) && options->loadSnapshotPath == NULL)
+    {
+        return INVALID; // changes can only be applied to a snapshot
+    }
+    if (options->maxRowsInMemory > 0 && strcmp(argv[1], MERGE_STR))
+    {
+        return INVALID; // only merge can sort without keeping all the students
+    }
+    if (options->maxRowsInMemory > 0 && (options->loadSnapshotPath != NULL || options->saveSnapshotPath != NULL ||
+                                         options->duplicateMode != KEEP_DUPLICATES))
+    {
+        return INVALID; // these need all the students in memory
+    }
+    return VALID;
+}
+
+
 /**
  * The main function - runs the program
  * @param argc - the number of parameters
@@ -543,59 +4567,109 @@ void printStudents(int numOfStudents, Student studentsArray[])
  */
 int main(int argc, char *argv[])
 {
-    if (argc != NUM_OF_EXPECTED_ARGS) // check if num of given arguments is 1
+    Options options;
+    if (argc < NUM_OF_EXPECTED_ARGS || !parseOptions(argc, argv, &options)) // check if a command was given
     {
         printf(USAGE_MSG);
         return UNSUCCESSFUL;
     }
 
-    Student studentsArray[MAX_NUM_STUDENTS];
-    int numOfStudents = 0;
-    int bestStudentIndex = 0;
+    StudentStore store;
 
     if ((strlen(argv[1]) == LEN_OF_BEST) && (!(strcmp(argv[1], BEST_STR)))) // the user typed "best"
     {
-        numOfStudents = buildStudentsArray(studentsArray); // build an array of input students
-        if (numOfStudents == NO_STUDENTS) // check if there are no students from input
+        if (options.loadSnapshotPath == NULL && options.saveSnapshotPath == NULL &&
+            options.duplicateMode == KEEP_DUPLICATES) // no need to keep the students
         {
+            TopStudents top;
+            findTopStudents(options.inputPath, options.top > 0 ? options.top : 1, &top); // find while reading
+            for (int i = 0; i < top.size; i++)
+            {
+                printRankedStudent(options.top > 0 ? FORMAT_OF_FIELDS_PRINT : BEST_INFO, &top.heap[i]);
+            }
+            free(top.heap);
             return SUCCESSFUL;
         }
 
-        bestStudentIndex = findBestStudent(studentsArray, numOfStudents); // get index of best student
-        printf(BEST_INFO, studentsArray[bestStudentIndex].id,
-               studentsArray[bestStudentIndex].name, studentsArray[bestStudentIndex].grade,
-               studentsArray[bestStudentIndex].age, studentsArray[bestStudentIndex].country,
-               studentsArray[bestStudentIndex].city);
-
-        return SUCCESSFUL;
+        buildStore(&options, &store);
+        if (options.top > 0)
+        {
+            TopStudents top;
+            findTopStoredStudents(&store, options.top, &top);
+            for (int i = 0; i < top.size; i++)
+            {
+                printRankedStudent(FORMAT_OF_FIELDS_PRINT, &top.heap[i]);
+            }
+            free(top.heap);
+        }
+        else if (store.numOfStudents != NO_STUDENTS)
+        {
+            printStudent(BEST_INFO, &store, findBestStudent(&store));
+        }
     }
 
     else if ((strlen(argv[1]) == LEN_OF_MERGE) && (!(strcmp(argv[1], MERGE_STR)))) // the user typed "merge"
     {
-        numOfStudents = buildStudentsArray(studentsArray); // build an array of input students
-        if (numOfStudents == NO_STUDENTS) // check if there are no students from input
+        if (options.maxRowsInMemory > 0) // sort without keeping all the students
         {
+            sortExternally(options.inputPath, options.maxRowsInMemory);
             return SUCCESSFUL;
         }
-
-        mergeSort(studentsArray, 0, numOfStudents - 1); // sort the students according to grades
-        printStudents(numOfStudents, studentsArray);
+        buildStore(&options, &store); // build a store of input students
+        printStudents(&store, getGradeOrder(&store, options.numOfThreads), store.numOfStudents); // by grades
     }
     else if ((strlen(argv[1]) == LEN_OF_QUICK) && (!(strcmp(argv[1], QUICK_STR)))) // the user typed "quick"
     {
-        numOfStudents = buildStudentsArray(studentsArray); // build an array of input students
-        if (numOfStudents == NO_STUDENTS) // check if there are no students from input
+        buildStore(&options, &store); // build a store of input students
+        printStudents(&store, getNameOrder(&store), store.numOfStudents);
+    }
+
+    else if ((strlen(argv[1]) == LEN_OF_QUERY) && (!(strcmp(argv[1], QUERY_STR)))) // the user typed "query"
+    {
+        buildStore(&options, &store);
+        int numOfSelected = 0;
+        SortEntry* order = runQuery(&options.query, &store, &numOfSelected);
+        printStudents(&store, order, numOfSelected);
+        free(order);
+    }
+
+    else if ((strlen(argv[1]) == LEN_OF_GROUP) && (!(strcmp(argv[1], GROUP_STR)))) // the user typed "group"
+    {
+        GroupTable table;
+        if (options.loadSnapshotPath == NULL && options.saveSnapshotPath == NULL &&
+            options.duplicateMode == KEEP_DUPLICATES) // group while reading
         {
-            return SUCCESSFUL;
+            initStudentStore(&store, 0); // only the pool and the interned places are used
+            initGroupTable(&table, options.groupField, &store);
+            readRows(options.inputPath, groupStudent, &table);
+        }
+        else
+        {
+            buildStore(&options, &store);
+            initGroupTable(&table, options.groupField, &store);
+            groupStoredStudents(&store, &table);
         }
+        printGroups(&table, store.pool.data);
+        freeGroupTable(&table);
+    }
 
-        quickSort(studentsArray, 0, numOfStudents - 1);
-        printStudents(numOfStudents, studentsArray);
+    else if ((strlen(argv[1]) == LEN_OF_GENERATE) && (!(strcmp(argv[1], GENERATE_STR)))) // the user typed "generate"
+    {
+        generateStudents(&options);
+        return SUCCESSFUL;
+    }
+    else if ((strlen(argv[1]) == LEN_OF_BENCH) && (!(strcmp(argv[1], BENCH_STR))) && options.inputPath != NULL)
+    {
+        runBenchmark(&options); // the user typed "bench" with an input file
+        return SUCCESSFUL;
     }
 
-    else // not "best", "merge" or "quick" - usage
+    else // not a known command - usage
     {
         printf(USAGE_MSG);
         return UNSUCCESSFUL;
     }
+
+    freeStudentStore(&store);
+    return SUCCESSFUL;
 }
\ No newline at end of file
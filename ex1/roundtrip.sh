@@ -0,0 +1,65 @@
+#!/bin/bash
+# Round trips generated rosters through manageStudents - every command must print the same with and without
+# threads, the external merge must match the in-memory one, and a saved snapshot must give back what the input
+# gave. Usage: roundtrip.sh [binary] [rows] [threads]
+set -eu
+
+BIN=$(realpath "${1:-./manageStudents}")
+ROWS=${2:-50000}
+THREADS=${3:-4}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+numOfFailed=0
+
+# compares two outputs of the same command, which are expected to be identical
+expectSame()
+{
+    if ! cmp -s "$2" "$3"; then
+        echo "FAILED: $1"
+        diff "$2" "$3" | head -5
+        numOfFailed=$((numOfFailed + 1))
+    fi
+}
+
+for distribution in sorted reversed random duplicates; do
+    "$BIN" generate --rows "$ROWS" --distribution "$distribution" --seed 7 > input.txt
+
+    # serial against threaded, for every command which reads the whole roster
+    for command in best merge quick group; do
+        "$BIN" $command --input input.txt > serial.txt
+        "$BIN" $command --input input.txt --threads "$THREADS" > threaded.txt
+        expectSame "$distribution $command --threads" serial.txt threaded.txt
+    done
+    "$BIN" best --input input.txt --top 10 > serial.txt
+    "$BIN" best --input input.txt --top 10 --threads "$THREADS" > threaded.txt
+    expectSame "$distribution best --top --threads" serial.txt threaded.txt
+    query=(--keys country,-grade,name --filter "age>=30" --filter "grade<90")
+    "$BIN" query --input input.txt "${query[@]}" > serial.txt
+    "$BIN" query --input input.txt "${query[@]}" --threads "$THREADS" > threaded.txt
+    expectSame "$distribution query --threads" serial.txt threaded.txt
+
+    # the external merge against the in-memory one
+    "$BIN" merge --input input.txt > merge.txt
+    "$BIN" merge --input input.txt --max-rows-in-memory $((ROWS / 7 + 1)) > external.txt
+    expectSame "$distribution merge --max-rows-in-memory" merge.txt external.txt
+
+    # the snapshot against the input it was saved from, also after saving it over itself
+    "$BIN" quick --input input.txt --save-snapshot roster.snap > quick.txt
+    for pass in saved resaved; do
+        "$BIN" merge --load-snapshot roster.snap > loaded.txt
+        expectSame "$distribution $pass snapshot merge" merge.txt loaded.txt
+        "$BIN" quick --load-snapshot roster.snap > loaded.txt
+        expectSame "$distribution $pass snapshot quick" quick.txt loaded.txt
+        "$BIN" query --input input.txt "${query[@]}" > serial.txt
+        "$BIN" query --load-snapshot roster.snap "${query[@]}" > loaded.txt
+        expectSame "$distribution $pass snapshot query" serial.txt loaded.txt
+        "$BIN" merge --load-snapshot roster.snap --save-snapshot roster.snap > /dev/null
+    done
+done
+
+if [ "$numOfFailed" -ne 0 ]; then
+    echo "$numOfFailed round trips failed"
+    exit 1
+fi
+echo "all round trips passed"
@@ -6,16 +6,25 @@
  * @brief System to find the the minimal price of the railway which can be built from the given parts
  */
 
+#define _DEFAULT_SOURCE // for madvise
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
 #include <string.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 
 #define RESIZE_NUM_OF_PARTS 50
 #define NUM_OF_ALL_CHARS 256
 #define NOT_USED -1
 #define NUM_OF_EXPECTED_ARGS 2
+#define NUM_OF_ARGS_WITH_THREADS 4
+#define THREADS_OPTION "--threads"
+#define MAX_NUM_OF_THREADS 256
+#define SPINS_BEFORE_YIELD 64
 #define BASE 10
 #define MAX_CH_IN_ROW 1024
 #define SUCCESSFUL 1
@@ -36,15 +45,18 @@
 #define OUTPUT_FILE "railway_planner_output.txt"
 #define WRITE "w"
 #define READ "r"
-#define ERR_NUM_ARGS_INVALID "Usage: RailwayPlanner <InputFile>"
+#define ERR_NUM_ARGS_INVALID "Usage: RailwayPlanner <InputFile> [--threads <n>]"
 #define ERR_DOESNT_EXIST "File doesn't exists."
 #define ERR_EMPTY_FILE "File is empty."
 #define ERR_INVALID_INPUT "Invalid input in line: %d."
 #define DELIMITER ','
 #define SSCANF_FORMAT "%1024[^,],%1024[^,],%1024[^,],%1024[^,]"
-#define MINIMAL_PRICE_MSG "The minimal price is: %d"
+#define MINIMAL_PRICE_MSG "The minimal price is: %lld"
 #define END_OF_LINE '\n'
 #define END_OF_STR '\0'
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define MAX_STATE_SIZE 1024
 
 /**
  * This struct represents a part, which is used to build the rail
@@ -59,57 +71,270 @@ typedef struct Part
 
 
 /**
- * This function fills the cell with the minimal price for railway in length "row",
- * which ends with right connection "col"
- * @param row - the row we are filling
- * @param col - the column we are filling
- * @param table - the table we are filling
+ * This struct represents a part as it is used in the table - instead of its left connection, it keeps how far back
+ * from the cell it fills is the cell of the railway it continues
+ */
+typedef struct IndexedPart
+{
+    long cellsBack; // pLen rows back, in the column of the left connection
+    int pLen; // length
+    int price;
+} IndexedPart;
+
+/**
+ * This struct holds the parts grouped by their right connection - the parts which end with column "col" are
+ * parts[firstOfCol[col]] until parts[firstOfCol[col + 1] - 1], sorted by their length
+ */
+typedef struct PartsByEnd
+{
+    int* firstOfCol; // numOfCols + 1 offsets into parts
+    IndexedPart* parts;
+    int maxPLen; // the length of the longest part, 0 if there are no parts
+    int minPLen; // the length of the shortest part, 0 if there are no parts
+} PartsByEnd;
+
+/**
+ * This struct represents the table - the last rows, kept one after the other in a single buffer. a row d rows back
+ * is always found d * stride cells before the current one - either because the rows which can still be looked at
+ * are moved to the start of the buffer once it is full, or because the rows wrap around a ring whose last rows are
+ * mirrored right before its start
+ */
+typedef struct Table
+{
+    long long* cells;
+    long stride; // the number of cells from the start of a row to the start of the next one, whole cache lines
+    long numOfRows; // the number of rows the buffer has room for
+} Table;
+
+/**
+ * This struct holds the next row a thread of a wavefront is going to fill, alone in its cache line so the threads
+ * don't slow each other down when they publish their progress. the struct is aligned to a cache line, so whatever
+ * holds it must be allocated aligned as well
+ */
+typedef struct __attribute__((aligned(CACHE_LINE_SIZE))) PublishedRow
+{
+    long nextRow; // accessed atomically
+    char padding[CACHE_LINE_SIZE - sizeof(long)];
+} PublishedRow;
+
+/**
+ * This struct represents a wavefront - threads which fill the table together. every thread fills a range of
+ * columns in every numOfRowGroups-th row, and a row may be filled once all rows minPLen rows before it are
+ */
+typedef struct Wavefront
+{
+    Table table; // the whole buffer - the mirrored rows, and then the ring
+    Table ring; // row r is kept in row r % numOfRows of the ring
+    long numOfMirroredRows; // the last rows of the ring, which are copied to right before its start
+    const PartsByEnd* partsByEnd;
+    long lenOfRail;
+    long numOfCols;
+    int numOfThreads; // the threads which take part in filling, set before the wavefront starts
+    int numOfRowGroups;
+    int numOfColGroups;
+    int isStarted; // accessed atomically
+    PublishedRow published[MAX_NUM_OF_THREADS];
+} Wavefront;
+
+/**
+ * This struct represents the work of one thread of a wavefront
+ */
+typedef struct WavefrontTask
+{
+    Wavefront* wavefront;
+    int id;
+} WavefrontTask;
+
+/**
+ * This function compares two indexed parts by their length, for qsort
+ * @param a - pointer to the first part
+ * @param b - pointer to the second part
+ * @return negative if the first part is shorter, positive if it is longer, 0 if they have the same length
+ */
+int comparePartsByLen(const void* a, const void* b)
+{
+    const IndexedPart* first = (const IndexedPart*)a;
+    const IndexedPart* second = (const IndexedPart*)b;
+    return (first->pLen > second->pLen) - (first->pLen < second->pLen);
+}
+
+/**
+ * This function calculates the number of cells from the start of a row of the table to the start of the next one,
+ * rounded up to whole cache lines so every row starts on its own line
+ * @param numOfCols - the number of columns in the table
+ * @return the stride of the rows
+ */
+long getRowStride(const long numOfCols)
+{
+    const long cellsInLine = CACHE_LINE_SIZE / (long)sizeof(long long);
+    return (numOfCols + cellsInLine - 1) / cellsInLine * cellsInLine;
+}
+
+/**
+ * This function groups the parts by the column of their right connection, so filling a cell only visits the parts
+ * which can end there
+ * @param numOfCols - the number of columns in the table
+ * @param stride - the stride of the rows of the table
  * @param parts - an array of the parts which can be used to build the railway
  * @param numOfParts - the number of the parts which we can use to build the railway
  * @param indexOfConnectionArray - an array which represents which chars(connections) are being used,
  * and their index in the table
+ * @param partsByEnd - the grouped parts to fill
  */
-void fillCell(const int row, const int col, int ** table, const Part* const parts, const int numOfParts,
-              const int indexOfConnectionArray[])
+void groupPartsByEnd(const long numOfCols, const long stride, const Part* const parts, const int numOfParts,
+                     const int indexOfConnectionArray[], PartsByEnd* partsByEnd)
 {
-    int minPrice = INT_MAX;
-    int indexOfStart = 0;
-    for (int i = 0; i < numOfParts; i++) // iterate all the parts
+    partsByEnd->firstOfCol = (int*)calloc(numOfCols + 1, sizeof(int));
+    partsByEnd->parts = (IndexedPart*)malloc((numOfParts > 0 ? numOfParts : 1) * sizeof(IndexedPart));
+    if (partsByEnd->firstOfCol == NULL || partsByEnd->parts == NULL) // couldn't allocate memory
     {
-        if (indexOfConnectionArray[(int)(parts[i].end)] == col) // found potential matching part (by edges)
+        exit(EXIT_FAILURE);
+    }
+
+    // count the parts of every column, a part with a connection outside of the table can never be used
+    partsByEnd->maxPLen = 0;
+    partsByEnd->minPLen = 0;
+    for (int i = 0; i < numOfParts; i++)
+    {
+        const int start = indexOfConnectionArray[(int)(parts[i].start)];
+        const int end = indexOfConnectionArray[(int)(parts[i].end)];
+        if (start < numOfCols && end < numOfCols)
         {
-            indexOfStart = indexOfConnectionArray[(int)(parts[i].start)]; // index (column) of the left connection
-            if (row - parts[i].pLen >= 0 &&
-                table[row-parts[i].pLen][indexOfStart] != INT_MAX &&
-                table[row-parts[i].pLen][indexOfStart] + parts[i].price >= 0 && // making sure there isn't int overflow
-                table[row-parts[i].pLen][indexOfStart] + parts[i].price < minPrice)
+            partsByEnd->firstOfCol[end + 1]++;
+            if (parts[i].pLen > partsByEnd->maxPLen)
+            {
+                partsByEnd->maxPLen = parts[i].pLen;
+            }
+            if (partsByEnd->minPLen == 0 || parts[i].pLen < partsByEnd->minPLen)
             {
-                minPrice = table[row-parts[i].pLen][indexOfStart] + parts[i].price;
+                partsByEnd->minPLen = parts[i].pLen;
             }
         }
     }
-    table[row][col] = minPrice; // fill the cell
+    for (long col = 0; col < numOfCols; col++)
+    {
+        partsByEnd->firstOfCol[col + 1] += partsByEnd->firstOfCol[col];
+    }
+
+    // place every part after the parts of its column which were already placed
+    int* nextOfCol = (int*)malloc((numOfCols > 0 ? numOfCols : 1) * sizeof(int));
+    if (nextOfCol == NULL) // couldn't allocate memory
+    {
+        exit(EXIT_FAILURE);
+    }
+    memcpy(nextOfCol, partsByEnd->firstOfCol, numOfCols * sizeof(int));
+    for (int i = 0; i < numOfParts; i++)
+    {
+        const int start = indexOfConnectionArray[(int)(parts[i].start)];
+        const int end = indexOfConnectionArray[(int)(parts[i].end)];
+        if (start < numOfCols && end < numOfCols)
+        {
+            IndexedPart* part = &partsByEnd->parts[nextOfCol[end]++];
+            part->cellsBack = parts[i].pLen * stride - start;
+            part->pLen = parts[i].pLen;
+            part->price = parts[i].price;
+        }
+    }
+    free(nextOfCol);
+    nextOfCol = NULL;
+
+    for (long col = 0; col < numOfCols; col++)
+    {
+        const int first = partsByEnd->firstOfCol[col];
+        qsort(partsByEnd->parts + first, partsByEnd->firstOfCol[col + 1] - first, sizeof(IndexedPart),
+              comparePartsByLen);
+    }
 }
 
 /**
- * This function fills the row with the minimal price for railway in length "row"
- * @param numOfCols - the number of
+ * This function frees the grouped parts
+ * @param partsByEnd - the grouped parts
+ */
+void freePartsByEnd(PartsByEnd* partsByEnd)
+{
+    free(partsByEnd->firstOfCol);
+    partsByEnd->firstOfCol = NULL;
+    free(partsByEnd->parts);
+    partsByEnd->parts = NULL;
+}
+
+/**
+ * This function fills the cell with the minimal price for railway in length "row",
+ * which ends with right connection "col"
  * @param row - the row we are filling
+ * @param rowStart - the index of the first cell of the row in the table
+ * @param col - the column we are filling
  * @param table - the table we are filling
- * @param parts - an array of the parts which can be used to build the railway
- * @param numOfParts - the number of the parts which we can use to build the railway
- * @param indexOfConnectionArray - an array which represents which chars(connections) are being used,
- * and their index in the table
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
+ */
+void fillCell(const long row, const long rowStart, const int col, const Table* const table,
+              const PartsByEnd* const partsByEnd)
+{
+    long long minPrice = LLONG_MAX;
+    for (int i = partsByEnd->firstOfCol[col]; i < partsByEnd->firstOfCol[col + 1]; i++) // parts ending with "col"
+    {
+        const IndexedPart* const part = &partsByEnd->parts[i];
+        if (part->pLen > row)
+        {
+            break; // the parts are sorted by length, so the rest of them are too long as well
+        }
+        const long long prevPrice = table->cells[rowStart - part->cellsBack];
+        if (prevPrice != LLONG_MAX &&
+            part->price <= LLONG_MAX - prevPrice && // making sure there isn't overflow
+            prevPrice + part->price < minPrice)
+        {
+            minPrice = prevPrice + part->price;
+        }
+    }
+    table->cells[rowStart + col] = minPrice; // fill the cell
+}
+
+/**
+ * This function fills the row with the minimal price for railway in length "row", in a range of columns
+ * @param firstCol - the first column to fill
+ * @param endCol - the column after the last one to fill
+ * @param row - the row we are filling
+ * @param rowStart - the index of the first cell of the row in the table
+ * @param table - the table we are filling
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
  */
-void fillRow(const long numOfCols, const int row, int ** table, const Part* const parts, const int numOfParts,
-             const int indexOfConnectionArray[])
+void fillRow(const long firstCol, const long endCol, const long row, const long rowStart, const Table* const table,
+             const PartsByEnd* const partsByEnd)
 {
-    for (int col = 0; col < numOfCols; col++) // iterate every cell in this row
+    for (int col = (int)firstCol; col < endCol; col++) // iterate every cell in this range of the row
     {
-        fillCell(row, col, table, parts, numOfParts, indexOfConnectionArray);
+        fillCell(row, rowStart, col, table, partsByEnd);
     }
 }
 
+/**
+ * This function allocates the table as one aligned buffer, where big tables are backed by huge pages when the
+ * system allows it, to save TLB misses
+ * @param numOfRows - the number of rows the table has room for
+ * @param stride - the stride of the rows
+ * @param table - the table to allocate
+ */
+void allocateTable(const long numOfRows, const long stride, Table* table)
+{
+    table->stride = stride;
+    table->numOfRows = numOfRows;
+
+    const size_t bytes = table->numOfRows * table->stride * sizeof(long long);
+    const size_t alignment = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : CACHE_LINE_SIZE;
+    void* cells = NULL;
+    if (posix_memalign(&cells, alignment, bytes) != 0) // couldn't allocate memory
+    {
+        exit(EXIT_FAILURE);
+    }
+#ifdef MADV_HUGEPAGE
+    if (alignment == HUGE_PAGE_SIZE)
+    {
+        madvise(cells, bytes, MADV_HUGEPAGE); // only a hint - the table works the same without it
+    }
+#endif
+    table->cells = (long long*)cells;
+}
+
 /**
  * This function handles errors - opens an output file to print an informative message to
  * @param message - the message that should be printed to file
@@ -389,72 +614,415 @@ void getInput(const char arg[], Part** pParts, int* pPartCounter, long* pNumOfCo
 }
 
 /**
- * This function is responsible for calculating and returning the minimal price of the railway that can be built
- * from the given parts
+ * This function calculates the minimal price of a railway in length "lenOfRail" for every right connection, by
+ * filling the table row by row
  * @param lenOfRail - The length of the railway
  * @param numOfConnections - The number of connections
- * @param partCounter - The number of the parts
- * @param parts - the parts that buld the railway
- * @param indexOfConnectionArray - an array which represents which chars(connections) are being used,
- * and their index in the table
- * @return The minimal price of the railway
+ * @param stride - the stride of the rows of the table
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
+ * @return The minimal price of the railway, LLONG_MAX if it can't be built
  */
-int calculateMinPrice(const long lenOfRail, const long numOfConnections, const int partCounter,
-                      const Part* const parts, const int indexOfConnectionArray[])
+long long calculateMinPriceByRows(const long lenOfRail, const long numOfConnections, const long stride,
+                                  const PartsByEnd* const partsByEnd)
 {
-    int minPriceForLenL = INT_MAX;
+    long long minPriceForLenL = LLONG_MAX;
+
+    // a cell never looks more than the longest part back, so the table only keeps the last rows, with room for as
+    // many new rows as kept ones, so moving rows is rare
+    const long lookBack = partsByEnd->maxPLen < lenOfRail ? partsByEnd->maxPLen : lenOfRail;
+    Table table;
+    allocateTable(2 * lookBack + 1, stride, &table);
+    const long endOfCells = table.numOfRows * table.stride;
+    const long keptCells = lookBack * table.stride;
+    long rowStart = 0;
 
-    // build the table -
-    int ** table  = (int**)malloc((lenOfRail + 1) * sizeof(int*));
-    if (table == NULL) // couldn't allocate memory (according to instructions - in this case no need to free memory)
+    // set the first row of table to be zeros
+    for(int i = 0; i < numOfConnections ; i++)
     {
-        exit(EXIT_FAILURE);
+        table.cells[i] = INITIALIZE;
     }
 
-    for (int i = 0; i < lenOfRail + 1; i++)
+    // fill the table to find the minimal price, row by row
+    for (long row = 1; row <= lenOfRail; row++)
     {
-        table[i] = (int*)malloc(numOfConnections * sizeof(int));
-        if (table[i] == NULL) // couldn't allocate memory (according to instructions - in this case no need
-            // to free memory)
+        rowStart += table.stride;
+        if (rowStart == endOfCells) // no room for this row - move the rows it may look at to the start
         {
-            exit(EXIT_FAILURE);
+            memmove(table.cells, table.cells + endOfCells - keptCells, keptCells * sizeof(long long));
+            rowStart = keptCells;
         }
+        fillRow(0, numOfConnections, row, rowStart, &table, partsByEnd);
     }
 
-    // set the first row of table to be zeros
-    for(int i = 0; i < numOfConnections ; i++)
+    // traverse "lenOfRail"-th row, to find minimum price
+    const long long* const lastRow = table.cells + rowStart;
+    for (int i = 0; i < numOfConnections; i++)
     {
-        table[ROW_NUM_1][i] = INITIALIZE;
+        if (lastRow[i] < minPriceForLenL)
+        {
+            minPriceForLenL = lastRow[i];
+        }
     }
 
-    // fill the table to find the minimal price, row by row
-    for (int row = 1; row <= lenOfRail; row++)
+    // free memory of table
+    free(table.cells);
+    table.cells = NULL;
+    return minPriceForLenL;
+}
+
+/**
+ * This function waits until every row up to "lastRow" is filled by the threads of the wavefront
+ * @param wavefront - the wavefront
+ * @param lastRow - the last row which must be filled
+ */
+void waitForRows(Wavefront* wavefront, const long lastRow)
+{
+    for (int t = 0; t < wavefront->numOfThreads; t++) // a thread whose next row is later has filled its earlier rows
+    {
+        for (int spins = 0; __atomic_load_n(&wavefront->published[t].nextRow, __ATOMIC_ACQUIRE) <= lastRow; spins++)
+        {
+            if (spins >= SPINS_BEFORE_YIELD) // the other thread is far behind, let it run
+            {
+                sched_yield();
+            }
+        }
+    }
+}
+
+/**
+ * This function fills the cells of one thread of a wavefront - its range of columns, in every numOfRowGroups-th row
+ * @param arg - the task of the thread
+ * @return NULL
+ */
+void* runWavefrontTask(void* arg)
+{
+    const WavefrontTask* const task = (const WavefrontTask*)arg;
+    Wavefront* const wavefront = task->wavefront;
+    for (int spins = 0; !__atomic_load_n(&wavefront->isStarted, __ATOMIC_ACQUIRE); spins++)
+    {
+        if (spins >= SPINS_BEFORE_YIELD) // the threads are still being created
+        {
+            sched_yield();
+        }
+    }
+    if (task->id >= wavefront->numOfThreads) // there was no work left for this thread
+    {
+        return NULL;
+    }
+
+    const long rowGroup = task->id / wavefront->numOfColGroups;
+    const long colGroup = task->id % wavefront->numOfColGroups;
+    const long firstCol = wavefront->numOfCols * colGroup / wavefront->numOfColGroups;
+    const long endCol = wavefront->numOfCols * (colGroup + 1) / wavefront->numOfColGroups;
+    const Table* const ring = &wavefront->ring;
+    const long firstMirroredRow = ring->numOfRows - wavefront->numOfMirroredRows;
+    for (long row = rowGroup + 1; row <= wavefront->lenOfRail; row += wavefront->numOfRowGroups)
+    {
+        waitForRows(wavefront, row - wavefront->partsByEnd->minPLen); // the latest row a cell of this row may read
+        const long rowStart = (row % ring->numOfRows) * ring->stride;
+        fillRow(firstCol, endCol, row, rowStart, ring, wavefront->partsByEnd);
+        if (rowStart >= firstMirroredRow * ring->stride) // the later rows may reach this row from the ring's start
+        {
+            long long* const mirror = ring->cells + rowStart - ring->numOfRows * ring->stride;
+            memcpy(mirror + firstCol, ring->cells + rowStart + firstCol, (endCol - firstCol) * sizeof(long long));
+        }
+        __atomic_store_n(&wavefront->published[task->id].nextRow, row + wavefront->numOfRowGroups, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/**
+ * This function calculates the minimal price of a railway in length "lenOfRail" for every right connection, by
+ * filling the table with several threads. the rows a cell reads are at least minPLen rows back, so every minPLen rows
+ * in a row can be filled at the same time - the threads are split between up to minPLen groups of rows, and the
+ * columns are split between the threads of a group. no thread waits for the others as a whole, only for the rows its
+ * next row reads
+ * @param lenOfRail - The length of the railway
+ * @param numOfConnections - The number of connections
+ * @param stride - the stride of the rows of the table
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
+ * @param numOfThreads - the number of threads to fill with
+ * @return The minimal price of the railway, LLONG_MAX if it can't be built
+ */
+long long calculateMinPriceInParallel(const long lenOfRail, const long numOfConnections, const long stride,
+                                      const PartsByEnd* const partsByEnd, const int numOfThreads)
+{
+    long long minPriceForLenL = LLONG_MAX;
+    void* memory = NULL;
+    if (posix_memalign(&memory, CACHE_LINE_SIZE, sizeof(Wavefront)) != 0) // aligned for its published rows
     {
-        fillRow(numOfConnections, row, table, parts, partCounter, indexOfConnectionArray);
+        exit(EXIT_FAILURE); // couldn't allocate memory
+    }
+    Wavefront* wavefront = (Wavefront*)memory;
+
+    // the rows wrap around a ring - while a row is filled, the rows being read or filled by the other threads are at
+    // most maxPLen + minPLen - 1 rows back. a cell may reach maxPLen rows before the ring's start, so its last
+    // maxPLen rows are mirrored there
+    wavefront->numOfMirroredRows = partsByEnd->maxPLen;
+    allocateTable(wavefront->numOfMirroredRows + partsByEnd->maxPLen + partsByEnd->minPLen, stride,
+                  &wavefront->table);
+    wavefront->ring.cells = wavefront->table.cells + wavefront->numOfMirroredRows * stride;
+    wavefront->ring.stride = stride;
+    wavefront->ring.numOfRows = partsByEnd->maxPLen + partsByEnd->minPLen;
+    for(int i = 0; i < numOfConnections ; i++) // set the first row of table to be zeros
+    {
+        wavefront->ring.cells[i] = INITIALIZE;
+    }
+    wavefront->partsByEnd = partsByEnd;
+    wavefront->lenOfRail = lenOfRail;
+    wavefront->numOfCols = numOfConnections;
+    wavefront->isStarted = UNSUCCESSFUL;
+
+    // the threads wait until the wavefront starts, so it only counts on the threads which were created
+    WavefrontTask tasks[MAX_NUM_OF_THREADS];
+    pthread_t threads[MAX_NUM_OF_THREADS];
+    int numOfCreated = 1; // the current thread is the first one
+    tasks[0].wavefront = wavefront;
+    tasks[0].id = 0;
+    while (numOfCreated < numOfThreads)
+    {
+        tasks[numOfCreated].wavefront = wavefront;
+        tasks[numOfCreated].id = numOfCreated;
+        if (pthread_create(&threads[numOfCreated], NULL, runWavefrontTask, &tasks[numOfCreated]))
+        {
+            break;
+        }
+        numOfCreated++;
+    }
+
+    wavefront->numOfRowGroups = numOfCreated < partsByEnd->minPLen ? numOfCreated : partsByEnd->minPLen;
+    wavefront->numOfColGroups = numOfCreated / wavefront->numOfRowGroups;
+    if (wavefront->numOfColGroups > numOfConnections)
+    {
+        wavefront->numOfColGroups = (int)numOfConnections;
+    }
+    wavefront->numOfThreads = wavefront->numOfRowGroups * wavefront->numOfColGroups;
+    for (int t = 0; t < wavefront->numOfThreads; t++)
+    {
+        wavefront->published[t].nextRow = t / wavefront->numOfColGroups + 1; // the first row of its group
+    }
+    __atomic_store_n(&wavefront->isStarted, SUCCESSFUL, __ATOMIC_RELEASE);
+
+    runWavefrontTask(&tasks[0]);
+    for (int t = 1; t < numOfCreated; t++)
+    {
+        pthread_join(threads[t], NULL);
     }
 
     // traverse "lenOfRail"-th row, to find minimum price
+    const long long* const lastRow = wavefront->ring.cells + (lenOfRail % wavefront->ring.numOfRows) * stride;
     for (int i = 0; i < numOfConnections; i++)
     {
-        if (table[lenOfRail][i] < minPriceForLenL)
+        if (lastRow[i] < minPriceForLenL)
         {
-            minPriceForLenL = table[lenOfRail][i];
+            minPriceForLenL = lastRow[i];
         }
     }
 
-    if (minPriceForLenL == INT_MAX)
+    free(wavefront->table.cells);
+    wavefront->table.cells = NULL;
+    free(wavefront);
+    wavefront = NULL;
+    return minPriceForLenL;
+}
+
+/**
+ * This function multiplies matrices in the (min, +) semiring - every cell of the product is the minimum over k of
+ * left[i][k] + right[k][j]. LLONG_MAX stands for "can't be reached", and so does every sum which reaches it, since the
+ * prices only grow from there
+ * @param left - the left matrix, numOfRows x size
+ * @param right - the right matrix, size x size
+ * @param product - the matrix to put the product in, numOfRows x size
+ * @param numOfRows - the number of rows of the left matrix
+ * @param size - the number of columns of the left matrix, and of the rows and columns of the right one
+ */
+void multiplyMinPlus(const long long* const left, const long long* const right, long long* const product,
+                     const long numOfRows, const long size)
+{
+    for (long i = 0; i < numOfRows * size; i++)
     {
-        minPriceForLenL = NO_SOLUTION;
+        product[i] = LLONG_MAX;
     }
+    for (long i = 0; i < numOfRows; i++)
+    {
+        long long* const productRow = product + i * size;
+        for (long k = 0; k < size; k++)
+        {
+            const long long leftPrice = left[i * size + k];
+            if (leftPrice == LLONG_MAX)
+            {
+                continue;
+            }
+            const long long* const rightRow = right + k * size;
+            for (long j = 0; j < size; j++)
+            {
+                if (rightRow[j] < LLONG_MAX - leftPrice && leftPrice + rightRow[j] < productRow[j])
+                {
+                    productRow[j] = leftPrice + rightRow[j];
+                }
+            }
+        }
+    }
+}
 
-    // free memory of table
-    for (int i = 0; i < lenOfRail + 1; i++)
+/**
+ * This function calculates the minimal price of a railway in length "lenOfRail" for every right connection, by
+ * raising the step between rows of the table to the power "lenOfRail". the state is the last maxPLen rows -
+ * state[d * numOfConnections + col] is the cell in column "col", d rows before the current one - and one step
+ * fills a new row from it and shifts the older rows by one. the steps are combined by repeated squaring, so the
+ * time depends on the logarithm of the length instead of the length itself
+ * @param lenOfRail - The length of the railway
+ * @param numOfConnections - The number of connections
+ * @param stride - the stride of the rows the parts were grouped for
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
+ * @return The minimal price of the railway, LLONG_MAX if it can't be built
+ */
+long long calculateMinPriceByPowers(const long lenOfRail, const long numOfConnections, const long stride,
+                                    const PartsByEnd* const partsByEnd)
+{
+    long long minPriceForLenL = LLONG_MAX;
+    const long size = partsByEnd->maxPLen * numOfConnections;
+    long long* power = (long long*)malloc(size * size * sizeof(long long));
+    long long* square = (long long*)malloc(size * size * sizeof(long long));
+    long long* state = (long long*)malloc(size * sizeof(long long));
+    long long* nextState = (long long*)malloc(size * sizeof(long long));
+    if (power == NULL || square == NULL || state == NULL || nextState == NULL) // couldn't allocate memory
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    // the step - power[from][to] is the price of moving a railway ending at "from" to "to" one row later
+    for (long i = 0; i < size * size; i++)
+    {
+        power[i] = LLONG_MAX;
+    }
+    for (long i = numOfConnections; i < size; i++)
+    {
+        power[(i - numOfConnections) * size + i] = INITIALIZE; // the older rows only move one row back
+    }
+    for (long col = 0; col < numOfConnections; col++)
+    {
+        for (int i = partsByEnd->firstOfCol[col]; i < partsByEnd->firstOfCol[col + 1]; i++)
+        {
+            const IndexedPart* const part = &partsByEnd->parts[i];
+            const long start = part->pLen * stride - part->cellsBack; // column of the left connection
+            long long* const price = &power[((part->pLen - 1) * numOfConnections + start) * size + col];
+            if (part->price < *price)
+            {
+                *price = part->price;
+            }
+        }
+    }
+
+    // the state of row 0 - zeros, and no rows before it
+    for (long i = 0; i < size; i++)
     {
-        free(table[i]);
-        table[i] = NULL;
+        state[i] = i < numOfConnections ? INITIALIZE : LLONG_MAX;
     }
-    free(table);
-    table = NULL;
+
+    // power is the step raised to 2^bit, and it moves the state whenever the bit is on in "lenOfRail"
+    for (long rowsLeft = lenOfRail; rowsLeft > 0; rowsLeft /= 2)
+    {
+        if (rowsLeft % 2 == 1)
+        {
+            multiplyMinPlus(state, power, nextState, 1, size);
+            long long* temp = state;
+            state = nextState;
+            nextState = temp;
+        }
+        if (rowsLeft > 1)
+        {
+            multiplyMinPlus(power, power, square, size, size);
+            long long* temp = power;
+            power = square;
+            square = temp;
+        }
+    }
+
+    for (int i = 0; i < numOfConnections; i++)
+    {
+        if (state[i] < minPriceForLenL)
+        {
+            minPriceForLenL = state[i];
+        }
+    }
+
+    free(power);
+    power = NULL;
+    free(square);
+    square = NULL;
+    free(state);
+    state = NULL;
+    free(nextState);
+    nextState = NULL;
+    return minPriceForLenL;
+}
+
+/**
+ * This function checks if raising the step to a power is expected to be faster than filling the table row by row
+ * @param lenOfRail - The length of the railway
+ * @param numOfConnections - The number of connections
+ * @param partsByEnd - the parts which can be used to build the railway, grouped by their right connection
+ * @return 1 if the powers should be used, 0 otherwise
+ */
+int shouldUsePowers(const long lenOfRail, const long numOfConnections, const PartsByEnd* const partsByEnd)
+{
+    const double size = (double)partsByEnd->maxPLen * (double)numOfConnections;
+    if (size == 0 || size > MAX_STATE_SIZE)
+    {
+        return UNSUCCESSFUL;
+    }
+    int numOfSquares = 0;
+    for (long rowsLeft = lenOfRail; rowsLeft > 1; rowsLeft /= 2)
+    {
+        numOfSquares++;
+    }
+    const double rowsCost = (double)lenOfRail * (double)(numOfConnections + partsByEnd->firstOfCol[numOfConnections]);
+    const double powersCost = size * size * size * (numOfSquares + 1);
+    return powersCost < rowsCost ? SUCCESSFUL : UNSUCCESSFUL;
+}
+
+/**
+ * This function is responsible for calculating and returning the minimal price of the railway that can be built
+ * from the given parts
+ * @param lenOfRail - The length of the railway
+ * @param numOfConnections - The number of connections
+ * @param partCounter - The number of the parts
+ * @param parts - the parts that buld the railway
+ * @param indexOfConnectionArray - an array which represents which chars(connections) are being used,
+ * and their index in the table
+ * @param numOfThreads - the number of threads to fill the table with
+ * @return The minimal price of the railway
+ */
+long long calculateMinPrice(const long lenOfRail, const long numOfConnections, const int partCounter,
+                            const Part* const parts, const int indexOfConnectionArray[], const int numOfThreads)
+{
+    long long minPriceForLenL = LLONG_MAX;
+    PartsByEnd partsByEnd;
+    const long stride = getRowStride(numOfConnections);
+    groupPartsByEnd(numOfConnections, stride, parts, partCounter, indexOfConnectionArray, &partsByEnd);
+
+    // for very long rails, the rows are skipped by powers of the step from one row to the next
+    if (shouldUsePowers(lenOfRail, numOfConnections, &partsByEnd))
+    {
+        minPriceForLenL = calculateMinPriceByPowers(lenOfRail, numOfConnections, stride, &partsByEnd);
+    }
+    else if (numOfThreads > 1 && partsByEnd.maxPLen > 0 && lenOfRail > 0)
+    {
+        minPriceForLenL = calculateMinPriceInParallel(lenOfRail, numOfConnections, stride, &partsByEnd,
+                                                      numOfThreads);
+    }
+    else
+    {
+        minPriceForLenL = calculateMinPriceByRows(lenOfRail, numOfConnections, stride, &partsByEnd);
+    }
+
+    if (minPriceForLenL == LLONG_MAX)
+    {
+        minPriceForLenL = NO_SOLUTION;
+    }
+
+    freePartsByEnd(&partsByEnd);
     return minPriceForLenL;
 }
 
@@ -474,7 +1042,7 @@ void initializeArrayOfChars(int indexOfConnectionArray[])
  * This function prints the minimal price to an output file
  * @param minPrice
  */
-void handleOutputFile(const int minPrice)
+void handleOutputFile(const long long minPrice)
 {
     FILE* outputFile = fopen(OUTPUT_FILE, WRITE);
     if (outputFile == NULL) // there was a problem opening the output file
@@ -489,6 +1057,31 @@ void handleOutputFile(const int minPrice)
     }
 }
 
+/**
+ * This function reads the number of threads from the arguments
+ * @param argc - the number of parameters
+ * @param argv - the parameters
+ * @return the number of threads to use, 0 if the arguments are invalid
+ */
+int getNumOfThreads(const int argc, char *argv[])
+{
+    if (argc == NUM_OF_EXPECTED_ARGS)
+    {
+        return 1;
+    }
+    if (argc != NUM_OF_ARGS_WITH_THREADS || strcmp(argv[2], THREADS_OPTION) != 0)
+    {
+        return UNSUCCESSFUL;
+    }
+    char* end = NULL;
+    const long numOfThreads = strtol(argv[3], &end, BASE);
+    if (*end != END_OF_STR || numOfThreads < 1 || numOfThreads > MAX_NUM_OF_THREADS)
+    {
+        return UNSUCCESSFUL;
+    }
+    return (int)numOfThreads;
+}
+
 /**
  * The main function - runs the program
  * @param argc - the number of parameters
@@ -497,7 +1090,7 @@ void handleOutputFile(const int minPrice)
  */
 int main(int argc, char *argv[])
 {
-    int minPrice = 0;
+    long long minPrice = 0;
     long lenOfRail = 0;
     long numOfConnections = 0;
     int partCounter = 0;
@@ -506,8 +1099,9 @@ int main(int argc, char *argv[])
     // and their index in the table
     initializeArrayOfChars(indexOfConnectionArray);
 
-    // check if num of given arguments is 1
-    if (argc != NUM_OF_EXPECTED_ARGS)
+    // check if the given arguments are the input file, and optionally the number of threads
+    const int numOfThreads = getNumOfThreads(argc, argv);
+    if (!numOfThreads)
     {
         handleError(ERR_NUM_ARGS_INVALID, DUMMY_LINE);
         exit(EXIT_FAILURE);
@@ -515,7 +1109,8 @@ int main(int argc, char *argv[])
 
     getInput(argv[1], &parts, &partCounter, &numOfConnections, &lenOfRail, indexOfConnectionArray);
     // if we got here it means the input was completely valid - calculate the minimal price
-    minPrice = calculateMinPrice(lenOfRail, numOfConnections, partCounter, parts, indexOfConnectionArray);
+    minPrice = calculateMinPrice(lenOfRail, numOfConnections, partCounter, parts, indexOfConnectionArray,
+                                 numOfThreads);
     free(parts);
     parts = NULL;
     handleOutputFile(minPrice);